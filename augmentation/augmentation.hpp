@@ -12,8 +12,8 @@
 #ifndef MODELS_AUGMENTATION_AUGMENTATION_HPP
 #define MODELS_AUGMENTATION_AUGMENTATION_HPP
 
-#include <mlpack/methods/ann/layer/bilinear_interpolation.hpp>
 #include <mlpack/core/util/to_lower.hpp>
+#include <augmentation/augmentation_pipeline.hpp>
 #include <boost/regex.hpp>
 
 namespace mlpack {
@@ -21,7 +21,29 @@ namespace models {
 
 /**
  * Augmentation class used to perform augmentations by transforming the data.
- * For the list of supported augmentation, take a look at our wiki page.
+ * Resize is applied to every image, other augmentations are applied to each
+ * image with the augmentation probability. Supported augmentations are:
+ *
+ *  - "resize (width, height)"
+ *  - "letterbox (width, height, pad)": resizes without changing the aspect
+ *    ratio and pads the border with pad, 0 by default.
+ *  - "horizontal-flip", "vertical-flip"
+ *  - "random-crop (pad)": shifts the image by up to pad pixels.
+ *  - "rotate-90": rotates by a random multiple of 90 degrees.
+ *  - "rotate (angle)": rotates by up to angle degrees.
+ *  - "cutout (size)": sets a random size x size square to zero.
+ *  - "brightness (b)", "contrast (c)", "saturation (s)": scale brightness,
+ *    contrast or saturation by a random factor in [1 - x, 1 + x].
+ *  - "hue (h)": rotates hue by up to h turns.
+ *  - "color-jitter (b, c, s, h)": all of the above in a single pass.
+ *  - "grayscale": sets red, green and blue to the luma of the pixel.
+ *  - "scale (s)", "normalize (mean, std)", "channel-order (2, 1, 0)": always
+ *    applied, see AugmentationPipeline.
+ *
+ * More augmentations can be added to AugmentationKernels::Registry(). MixUp
+ * and CutMix mix images with their labels, see MixAugmentation.
+ * Augmentations are compiled into an AugmentationPipeline, so each image is
+ * only read and written once.
  *
  * @code
  * Augmentation augmentation({"horizontal-flip", "resize = (224, 224)"}, 0.2);
@@ -58,17 +80,19 @@ class Augmentation
     for (size_t i = 0; i < augmentations.size(); i++)
       this->augmentations[i] = mlpack::util::ToLower(augmentations[i]);
 
-    // Sort the vector to place resize parameter to the front of the string.
-    // This prevents constant lookups for resize.
-    sort(this->augmentations.begin(), this->augmentations.end(), [](
-        std::string& str1, std::string& str2)
+    // Move the resize parameter to the front of the vector, keeping the order
+    // of other augmentations. This prevents constant lookups for resize.
+    std::stable_partition(this->augmentations.begin(),
+        this->augmentations.end(), [this](const std::string& augmentation)
         {
-          return str1.find("resize") != std::string::npos;
+          return HasResizeParam(augmentation);
         });
   }
 
   /**
-   * Applies augmentation to the passed dataset.
+   * Applies augmentation to the passed dataset. Images are augmented in
+   * parallel, and flips and kernels are applied to an image with the
+   * augmentation probability.
    *
    * @tparam DatasetType Datatype on which augmentation will be done.
    * 
@@ -99,13 +123,47 @@ class Augmentation
    * @param datapointDepth Depth of a single data point. For one 2-dimensional
    *                       data point, set it to 1. Defaults to 1.
    * @param augmentation String containing the transform.
+   * @param numThreads Number of threads used. If 0, all threads available to
+   *     OpenMP are used.
    */
   template<typename DatasetType>
   void ResizeTransform(DatasetType& dataset,
                        const size_t datapointWidth,
                        const size_t datapointHeight,
                        const size_t datapointDepth,
-                       const std::string& augmentation);
+                       const std::string& augmentation,
+                       const size_t numThreads = 0);
+
+  /**
+   * Get the resize that an augmentation string applies to images of the
+   * given size. Its ScaleX(), ScaleY(), OffsetX() and OffsetY() map
+   * coordinates, such as bounding boxes, between the input and the resized
+   * image.
+   *
+   * @param width Width of input images.
+   * @param height Height of input images.
+   * @param depth Depth of input images.
+   * @param augmentation String containing the resize or letterbox transform.
+   */
+  BilinearResize GetResize(const size_t width,
+                           const size_t height,
+                           const size_t depth,
+                           const std::string& augmentation)
+  {
+    size_t outputWidth = width, outputHeight = height;
+    GetResizeParam(outputWidth, outputHeight, augmentation);
+
+    if (AugmentationPipeline::Name(augmentation) != "letterbox")
+    {
+      return BilinearResize(width, height, outputWidth, outputHeight,
+          depth);
+    }
+
+    const std::vector<double> params = AugmentationPipeline::Params(
+        augmentation);
+    return BilinearResize::Letterbox(width, height, outputWidth,
+        outputHeight, depth, params.size() > 2 ? params[2] : 0.0);
+  }
 
  private:
   /**
@@ -117,12 +175,14 @@ class Augmentation
   bool HasResizeParam(const std::string& augmentation = "")
   {
     if (augmentation.length())
-      return augmentation.find("resize") != std::string::npos;
-
+    {
+      return augmentation.find("resize") != std::string::npos ||
+          augmentation.find("letterbox") != std::string::npos;
+    }
 
     // Search in augmentation vector.
     return augmentations.size() <= 0 ? false :
-        augmentations[0].find("resize") != std::string::npos;
+        HasResizeParam(augmentations[0]);
   }
 
   /**
@@ -145,7 +205,7 @@ class Augmentation
 
     // Use regex to find one or two numbers. If only one provided
     // set output width equal to output height.
-    boost::regex regex{"[0-9]+"};
+    static const boost::regex regex{"[0-9]+"};
 
     // Create an iterator to find matches.
     boost::sregex_token_iterator matches(augmentation.begin(),
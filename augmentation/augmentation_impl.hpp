@@ -24,28 +24,10 @@ void Augmentation::Transform(DatasetType& dataset,
                              const size_t datapointHeight,
                              const size_t datapointDepth)
 {
-  // Initialize the augmentation map.
-  std::unordered_map<std::string, void(*)(DatasetType&,
-       size_t, size_t, size_t, std::string&)> augmentationMap;
-
-  for (size_t i = 0; i < augmentations.size(); i++)
-  {
-    if (augmentationMap.count(augmentations[i]))
-    {
-      augmentationMap[augmentations[i]](dataset, datapointWidth,
-        datapointHeight, datapointDepth, augmentations[i]);
-    }
-    else if (this->HasResizeParam(augmentations[i]))
-    {
-      this->ResizeTransform(dataset, datapointWidth, datapointHeight,
-        datapointDepth, augmentations[i]);
-    }
-    else
-    {
-      mlpack::Log::Warn << "Unknown augmentation : \'" <<
-          augmentations[i] << "\' not found!" << std::endl;
-    }
-  }
+  // Resize, flips and kernels are applied to each image in a single pass.
+  const AugmentationPipeline pipeline(augmentations, augmentationProbability,
+      datapointWidth, datapointHeight, datapointDepth);
+  pipeline.Apply(dataset);
 }
 
 template<typename DatasetType>
@@ -54,22 +36,12 @@ void Augmentation::ResizeTransform(
     const size_t datapointWidth,
     const size_t datapointHeight,
     const size_t datapointDepth,
-    const std::string& augmentation)
+    const std::string& augmentation,
+    const size_t numThreads)
 {
-  size_t outputWidth = 0, outputHeight = 0;
-
-  // Get output width and output height.
-  GetResizeParam(outputWidth, outputHeight, augmentation);
-
-  // We will use mlpack's bilinear interpolation layer to
-  // resize the input.
-  mlpack::ann::BilinearInterpolation<DatasetType, DatasetType> resizeLayer(
-      datapointWidth, datapointHeight, outputWidth, outputHeight,
-      datapointDepth);
-
-  DatasetType output;
-  resizeLayer.Forward(dataset, output);
-  dataset = std::move(output);
+  const BilinearResize resize = GetResize(datapointWidth, datapointHeight,
+      datapointDepth, augmentation);
+  resize.Apply(dataset, numThreads);
 }
 
 } // namespace models
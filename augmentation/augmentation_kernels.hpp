@@ -0,0 +1,637 @@
+/**
+ * @file augmentation_kernels.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of AugmentationKernels class holding in-place augmentations of
+ * single images.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_AUGMENTATION_AUGMENTATION_KERNELS_HPP
+#define MODELS_AUGMENTATION_AUGMENTATION_KERNELS_HPP
+
+#include <mlpack/prereqs.hpp>
+#include <augmentation/bilinear_resize.hpp>
+#include <unordered_map>
+#include <algorithm>
+#include <type_traits>
+#include <limits>
+#include <random>
+#include <cmath>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Registry of augmentation kernels. A kernel transforms a single image in
+ * place. Images are stored in the interleaved layout used by
+ * mlpack::data::Load(), i.e. channel c of pixel (x, y) is at index
+ * (y * width + x) * depth + c.
+ *
+ * Kernels are looked up by the name of an augmentation, which is the part of
+ * the augmentation string before any parameters, e.g. "cutout" for
+ * "cutout (8)". Custom kernels can be added to Registry() before any
+ * augmentation is applied.
+ *
+ * @tparam ElemType Type of a single pixel value.
+ */
+template<typename ElemType>
+class AugmentationKernels
+{
+ public:
+  /**
+   * Signature of a kernel.
+   *
+   * @param image Pointer to the first element of the image.
+   * @param width Width of the image.
+   * @param height Height of the image.
+   * @param depth Number of channels of the image.
+   * @param params Numbers given in the augmentation string.
+   * @param generator Random number generator of the image.
+   * @param buffer Buffer with at least width * height * depth elements.
+   */
+  typedef void (*KernelType)(ElemType* image,
+                             const size_t width,
+                             const size_t height,
+                             const size_t depth,
+                             const std::vector<double>& params,
+                             std::mt19937& generator,
+                             ElemType* buffer);
+
+  //! Get the map from names of augmentations to kernels.
+  static std::unordered_map<std::string, KernelType>& Registry()
+  {
+    static std::unordered_map<std::string, KernelType> registry = {
+        {"horizontal-flip", &HorizontalFlip},
+        {"vertical-flip", &VerticalFlip},
+        {"random-crop", &RandomCrop},
+        {"rotate-90", &Rotate90},
+        {"rotate", &Rotate},
+        {"cutout", &Cutout},
+        {"brightness", &Brightness},
+        {"contrast", &Contrast},
+        {"saturation", &Saturation},
+        {"hue", &Hue},
+        {"color-jitter", &ColorJitter},
+        {"grayscale", &Grayscale}};
+    return registry;
+  }
+
+  /**
+   * Get the kernel of an augmentation.
+   *
+   * @param name Name of the augmentation.
+   * @return Kernel of the augmentation, or nullptr if it isn't registered.
+   */
+  static KernelType Find(const std::string& name)
+  {
+    typename std::unordered_map<std::string, KernelType>::const_iterator it =
+        Registry().find(name);
+    return it == Registry().end() ? nullptr : it->second;
+  }
+
+  //! Mirrors the image along the vertical axis.
+  static void HorizontalFlip(ElemType* image,
+                             const size_t width,
+                             const size_t height,
+                             const size_t depth,
+                             const std::vector<double>& /* params */,
+                             std::mt19937& /* generator */,
+                             ElemType* /* buffer */)
+  {
+    for (size_t y = 0; y < height; y++)
+    {
+      ElemType* row = image + y * width * depth;
+      for (size_t x = 0; x < width / 2; x++)
+      {
+        std::swap_ranges(row + x * depth, row + (x + 1) * depth,
+            row + (width - 1 - x) * depth);
+      }
+    }
+  }
+
+  //! Mirrors the image along the horizontal axis.
+  static void VerticalFlip(ElemType* image,
+                           const size_t width,
+                           const size_t height,
+                           const size_t depth,
+                           const std::vector<double>& /* params */,
+                           std::mt19937& /* generator */,
+                           ElemType* /* buffer */)
+  {
+    const size_t rowSize = width * depth;
+    for (size_t y = 0; y < height / 2; y++)
+    {
+      std::swap_ranges(image + y * rowSize, image + (y + 1) * rowSize,
+          image + (height - 1 - y) * rowSize);
+    }
+  }
+
+  /**
+   * Pads the image with zeros on every side and crops a random window of the
+   * original size, i.e. shifts the image by a random offset. The padding is
+   * given by the first parameter and defaults to 4 pixels.
+   */
+  static void RandomCrop(ElemType* image,
+                         const size_t width,
+                         const size_t height,
+                         const size_t depth,
+                         const std::vector<double>& params,
+                         std::mt19937& generator,
+                         ElemType* buffer)
+  {
+    const long pad = params.empty() ? 4 : (long) params[0];
+    std::uniform_int_distribution<long> offset(-pad, pad);
+    const long dx = offset(generator);
+    const long dy = offset(generator);
+
+    // Pixel (x, y) of the output is pixel (x + dx, y + dy) of the input.
+    const long firstX = std::max(0L, -dx);
+    const long lastX = std::min((long) width, (long) width - dx);
+    const size_t rowSize = width * depth;
+    std::fill(buffer, buffer + height * rowSize, ElemType(0));
+    for (long y = std::max(0L, -dy); y < std::min((long) height,
+        (long) height - dy) && firstX < lastX; y++)
+    {
+      const ElemType* source = image + (y + dy) * rowSize +
+          (firstX + dx) * depth;
+      std::copy(source, source + (lastX - firstX) * depth,
+          buffer + y * rowSize + firstX * depth);
+    }
+
+    std::copy(buffer, buffer + height * rowSize, image);
+  }
+
+  /**
+   * Rotates the image by a random multiple of 90 degrees. Images that aren't
+   * square are rotated by 180 degrees, so their shape doesn't change.
+   */
+  static void Rotate90(ElemType* image,
+                       const size_t width,
+                       const size_t height,
+                       const size_t depth,
+                       const std::vector<double>& params,
+                       std::mt19937& generator,
+                       ElemType* buffer)
+  {
+    const size_t turns = (width == height) ?
+        std::uniform_int_distribution<size_t>(1, 3)(generator) : 2;
+    if (turns == 2)
+    {
+      HorizontalFlip(image, width, height, depth, params, generator, buffer);
+      VerticalFlip(image, width, height, depth, params, generator, buffer);
+      return;
+    }
+
+    // Clockwise: pixel (x, y) of the output is pixel (y, n - 1 - x) of the
+    // input. Counter-clockwise: pixel (n - 1 - y, x).
+    const size_t n = width;
+    for (size_t y = 0; y < n; y++)
+    {
+      for (size_t x = 0; x < n; x++)
+      {
+        const size_t source = (turns == 1) ? (n - 1 - x) * n + y :
+            x * n + (n - 1 - y);
+        std::copy(image + source * depth, image + (source + 1) * depth,
+            buffer + (y * n + x) * depth);
+      }
+    }
+
+    std::copy(buffer, buffer + n * n * depth, image);
+  }
+
+  /**
+   * Rotates the image around its center by a random angle using bilinear
+   * interpolation. Pixels outside of the input are zero. The maximum angle
+   * in degrees is given by the first parameter and defaults to 15.
+   */
+  static void Rotate(ElemType* image,
+                     const size_t width,
+                     const size_t height,
+                     const size_t depth,
+                     const std::vector<double>& params,
+                     std::mt19937& generator,
+                     ElemType* buffer)
+  {
+    const double maxAngle = params.empty() ? 15.0 : params[0];
+    const double angle = std::uniform_real_distribution<double>(-maxAngle,
+        maxAngle)(generator) * arma::datum::pi / 180.0;
+    const double cosine = std::cos(angle), sine = std::sin(angle);
+    const double centerX = (width - 1) / 2.0;
+    const double centerY = (height - 1) / 2.0;
+
+    for (size_t y = 0; y < height; y++)
+    {
+      for (size_t x = 0; x < width; x++)
+      {
+        // Inverse rotation of the output pixel gives its position in the
+        // input.
+        const double sourceX = cosine * (x - centerX) + sine * (y - centerY) +
+            centerX;
+        const double sourceY = -sine * (x - centerX) + cosine * (y - centerY) +
+            centerY;
+        Interpolate(image, width, height, depth, sourceX, sourceY,
+            buffer + (y * width + x) * depth);
+      }
+    }
+
+    std::copy(buffer, buffer + width * height * depth, image);
+  }
+
+  /**
+   * Sets a square at a random position of the image to zero. The square may
+   * be partially outside of the image. The side of the square is given by
+   * the first parameter and defaults to 8 pixels.
+   */
+  static void Cutout(ElemType* image,
+                     const size_t width,
+                     const size_t height,
+                     const size_t depth,
+                     const std::vector<double>& params,
+                     std::mt19937& generator,
+                     ElemType* /* buffer */)
+  {
+    const long size = params.empty() ? 8 : (long) params[0];
+    const long centerX = std::uniform_int_distribution<long>(0,
+        (long) width - 1)(generator);
+    const long centerY = std::uniform_int_distribution<long>(0,
+        (long) height - 1)(generator);
+
+    const long firstX = std::max(0L, centerX - size / 2);
+    const long lastX = std::min((long) width, centerX - size / 2 + size);
+    const long firstY = std::max(0L, centerY - size / 2);
+    const long lastY = std::min((long) height, centerY - size / 2 + size);
+    for (long y = firstY; y < lastY && firstX < lastX; y++)
+    {
+      std::fill(image + (y * width + firstX) * depth,
+          image + (y * width + lastX) * depth, ElemType(0));
+    }
+  }
+
+  /**
+   * Scales the image by a random factor in [1 - b, 1 + b]. The amount b is
+   * given by the first parameter and defaults to 0.2.
+   */
+  static void Brightness(ElemType* image,
+                         const size_t width,
+                         const size_t height,
+                         const size_t depth,
+                         const std::vector<double>& params,
+                         std::mt19937& generator,
+                         ElemType* /* buffer */)
+  {
+    Jitter(image, width * height, depth, false, params.empty() ? 0.2 :
+        params[0], 0.0, 0.0, 0.0, generator);
+  }
+
+  /**
+   * Blends the image with its mean luma by a random factor in [1 - c, 1 + c].
+   * The amount c is given by the first parameter and defaults to 0.2.
+   */
+  static void Contrast(ElemType* image,
+                       const size_t width,
+                       const size_t height,
+                       const size_t depth,
+                       const std::vector<double>& params,
+                       std::mt19937& generator,
+                       ElemType* /* buffer */)
+  {
+    Jitter(image, width * height, depth, false, 0.0, params.empty() ? 0.2 :
+        params[0], 0.0, 0.0, generator);
+  }
+
+  /**
+   * Blends each pixel with its luma by a random factor in [1 - s, 1 + s].
+   * The amount s is given by the first parameter and defaults to 0.2.
+   */
+  static void Saturation(ElemType* image,
+                         const size_t width,
+                         const size_t height,
+                         const size_t depth,
+                         const std::vector<double>& params,
+                         std::mt19937& generator,
+                         ElemType* /* buffer */)
+  {
+    Jitter(image, width * height, depth, false, 0.0, 0.0, params.empty() ?
+        0.2 : params[0], 0.0, generator);
+  }
+
+  /**
+   * Rotates colors around the gray axis by a random fraction of a full turn
+   * in [-h, h]. The amount h is given by the first parameter and defaults to
+   * 0.05.
+   */
+  static void Hue(ElemType* image,
+                  const size_t width,
+                  const size_t height,
+                  const size_t depth,
+                  const std::vector<double>& params,
+                  std::mt19937& generator,
+                  ElemType* /* buffer */)
+  {
+    Jitter(image, width * height, depth, false, 0.0, 0.0, 0.0,
+        params.empty() ? 0.05 : params[0], generator);
+  }
+
+  /**
+   * Jitters brightness, contrast, saturation and hue in a single pass. The
+   * parameters are the amounts of each, see the kernels above, and default
+   * to 0.2, 0.2, 0.2 and 0.05.
+   */
+  static void ColorJitter(ElemType* image,
+                          const size_t width,
+                          const size_t height,
+                          const size_t depth,
+                          const std::vector<double>& params,
+                          std::mt19937& generator,
+                          ElemType* /* buffer */)
+  {
+    Jitter(image, width * height, depth, false,
+        params.size() > 0 ? params[0] : 0.2,
+        params.size() > 1 ? params[1] : 0.2,
+        params.size() > 2 ? params[2] : 0.2,
+        params.size() > 3 ? params[3] : 0.05, generator);
+  }
+
+  //! Sets the red, green and blue channels of each pixel to its luma.
+  static void Grayscale(ElemType* image,
+                        const size_t width,
+                        const size_t height,
+                        const size_t depth,
+                        const std::vector<double>& /* params */,
+                        std::mt19937& /* generator */,
+                        ElemType* /* buffer */)
+  {
+    if (depth < 3)
+      return;
+
+    double matrix[3][3], offset[3] = {0.0, 0.0, 0.0};
+    for (size_t i = 0; i < 3; i++)
+      for (size_t j = 0; j < 3; j++)
+        matrix[i][j] = Luma(j);
+
+    TransformColors(image, width * height, depth, false, matrix, offset);
+  }
+
+  /**
+   * Randomly jitters brightness, contrast, saturation and hue of an image.
+   * The changes are composed into one affine map of colors, which is applied
+   * in a single pass. Saturation and hue only change images with at least
+   * three channels, the first three of which are red, green and blue.
+   *
+   * @param image Pointer to the first element of the image.
+   * @param pixels Number of pixels of the image.
+   * @param depth Number of channels of the image.
+   * @param planar Whether channels are stored one after another, as produced
+   *     by PreProcessor::ChannelFirstImages(), instead of interleaved.
+   * @param brightness Maximum change of the brightness factor, 0 to disable.
+   * @param contrast Maximum change of the contrast factor, 0 to disable.
+   * @param saturation Maximum change of the saturation factor, 0 to disable.
+   * @param hue Maximum rotation of hue as a fraction of a turn, 0 to disable.
+   * @param generator Random number generator of the image.
+   */
+  static void Jitter(ElemType* image,
+                     const size_t pixels,
+                     const size_t depth,
+                     const bool planar,
+                     const double brightness,
+                     const double contrast,
+                     const double saturation,
+                     const double hue,
+                     std::mt19937& generator)
+  {
+    const bool color = (depth >= 3);
+    const size_t channels = color ? 3 : 1;
+    double matrix[3][3] = {{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0},
+        {0.0, 0.0, 1.0}};
+    double offset[3] = {0.0, 0.0, 0.0};
+
+    if (brightness > 0)
+    {
+      const double factor = Factor(brightness, generator);
+      for (size_t i = 0; i < 3; i++)
+      {
+        for (size_t j = 0; j < 3; j++)
+          matrix[i][j] *= factor;
+      }
+    }
+
+    if (contrast > 0)
+    {
+      const double factor = Factor(contrast, generator);
+
+      // Colors are mapped linearly, so the mean luma of the mapped image is
+      // the luma of the mapped mean color.
+      std::vector<double> mean(channels, 0.0);
+      const size_t channelStride = planar ? pixels : 1;
+      const size_t pixelStride = planar ? 1 : depth;
+      for (size_t c = 0; c < channels; c++)
+      {
+        const ElemType* channel = image + c * channelStride;
+        double sum = 0.0;
+        #pragma omp simd reduction(+:sum)
+        for (size_t p = 0; p < pixels; p++)
+          sum += channel[p * pixelStride];
+        mean[c] = sum / std::max<size_t>(pixels, 1);
+      }
+
+      double luma = 0.0;
+      for (size_t i = 0; i < channels; i++)
+      {
+        double value = offset[i];
+        for (size_t j = 0; j < channels; j++)
+          value += matrix[i][j] * mean[j];
+        luma += (color ? Luma(i) : 1.0) * value;
+      }
+
+      for (size_t i = 0; i < 3; i++)
+      {
+        for (size_t j = 0; j < 3; j++)
+          matrix[i][j] *= factor;
+        offset[i] = factor * offset[i] + (1 - factor) * luma;
+      }
+    }
+
+    if (saturation > 0 && color)
+    {
+      // Blend with the luma of the pixel.
+      const double factor = Factor(saturation, generator);
+      double blend[3][3];
+      for (size_t i = 0; i < 3; i++)
+      {
+        for (size_t j = 0; j < 3; j++)
+          blend[i][j] = (i == j ? factor : 0.0) + (1 - factor) * Luma(j);
+      }
+
+      Compose(matrix, offset, blend);
+    }
+
+    if (hue > 0 && color)
+    {
+      // Rotation around the unit vector (1, 1, 1) / sqrt(3).
+      const double angle = std::uniform_real_distribution<double>(-hue,
+          hue)(generator) * 2 * arma::datum::pi;
+      const double cosine = std::cos(angle);
+      const double sine = std::sin(angle) / std::sqrt(3.0);
+      const double gray = (1 - cosine) / 3;
+      const double rotation[3][3] = {
+          {cosine + gray, gray - sine, gray + sine},
+          {gray + sine, cosine + gray, gray - sine},
+          {gray - sine, gray + sine, cosine + gray}};
+
+      Compose(matrix, offset, rotation);
+    }
+
+    TransformColors(image, pixels, depth, planar, matrix, offset);
+  }
+
+  /**
+   * Applies an affine map to the colors of every pixel of an image. Values
+   * of integral types are rounded and clamped to the range of the type.
+   * Images with less than three channels only have their first channel
+   * mapped, by matrix[0][0] and offset[0].
+   *
+   * @param image Pointer to the first element of the image.
+   * @param pixels Number of pixels of the image.
+   * @param depth Number of channels of the image.
+   * @param planar Whether channels are stored one after another instead of
+   *     interleaved.
+   * @param matrix Red, green and blue of the output are matrix times red,
+   *     green and blue of the input, plus offset.
+   * @param offset Offset added to each mapped channel.
+   */
+  static void TransformColors(ElemType* image,
+                              const size_t pixels,
+                              const size_t depth,
+                              const bool planar,
+                              const double (&matrix)[3][3],
+                              const double (&offset)[3])
+  {
+    const size_t channelStride = planar ? pixels : 1;
+    const size_t pixelStride = planar ? 1 : depth;
+
+    if (depth < 3)
+    {
+      const AccType scale = (AccType) matrix[0][0];
+      const AccType shift = (AccType) offset[0];
+      #pragma omp simd
+      for (size_t p = 0; p < pixels; p++)
+      {
+        ElemType& value = image[p * pixelStride];
+        value = Saturate(scale * value + shift);
+      }
+      return;
+    }
+
+    AccType m[3][3], o[3];
+    for (size_t i = 0; i < 3; i++)
+    {
+      o[i] = (AccType) offset[i];
+      for (size_t j = 0; j < 3; j++)
+        m[i][j] = (AccType) matrix[i][j];
+    }
+
+    ElemType* red = image;
+    ElemType* green = image + channelStride;
+    ElemType* blue = image + 2 * channelStride;
+    #pragma omp simd
+    for (size_t p = 0; p < pixels; p++)
+    {
+      const size_t i = p * pixelStride;
+      const AccType r = red[i], g = green[i], b = blue[i];
+      red[i] = Saturate(m[0][0] * r + m[0][1] * g + m[0][2] * b + o[0]);
+      green[i] = Saturate(m[1][0] * r + m[1][1] * g + m[1][2] * b + o[1]);
+      blue[i] = Saturate(m[2][0] * r + m[2][1] * g + m[2][2] * b + o[2]);
+    }
+  }
+
+ private:
+  //! Type used to compute colors, single precision unless images are stored
+  //! as doubles.
+  typedef typename std::conditional<std::is_same<ElemType, double>::value,
+      double, float>::type AccType;
+
+  //! Get the weight of red, green or blue in the luma of a pixel
+  //! (ITU-R BT.601).
+  static double Luma(const size_t channel)
+  {
+    return channel == 0 ? 0.299 : (channel == 1 ? 0.587 : 0.114);
+  }
+
+  //! Get a random factor in [1 - amount, 1 + amount], at least 0.
+  static double Factor(const double amount, std::mt19937& generator)
+  {
+    return std::uniform_real_distribution<double>(std::max(0.0, 1 - amount),
+        1 + amount)(generator);
+  }
+
+  //! Applies next after the affine map given by matrix and offset.
+  static void Compose(double (&matrix)[3][3],
+                      double (&offset)[3],
+                      const double (&next)[3][3])
+  {
+    double composed[3][3], shifted[3];
+    for (size_t i = 0; i < 3; i++)
+    {
+      shifted[i] = 0.0;
+      for (size_t j = 0; j < 3; j++)
+      {
+        shifted[i] += next[i][j] * offset[j];
+        composed[i][j] = 0.0;
+        for (size_t k = 0; k < 3; k++)
+          composed[i][j] += next[i][k] * matrix[k][j];
+      }
+    }
+
+    std::copy(&composed[0][0], &composed[0][0] + 9, &matrix[0][0]);
+    std::copy(shifted, shifted + 3, offset);
+  }
+
+  //! Converts a computed color to the element type, rounding and clamping
+  //! values of integral types.
+  static ElemType Saturate(const AccType value)
+  {
+    return BilinearResize::Cast<ElemType>(value);
+  }
+
+  /**
+   * Bilinearly interpolates all channels of the image at a position. Pixels
+   * outside of the image are zero.
+   */
+  static void Interpolate(const ElemType* image,
+                          const size_t width,
+                          const size_t height,
+                          const size_t depth,
+                          const double x,
+                          const double y,
+                          ElemType* output)
+  {
+    const double x0 = std::floor(x), y0 = std::floor(y);
+    const double wx = x - x0, wy = y - y0;
+    const long ix = (long) x0, iy = (long) y0;
+    const double weights[4] = {(1 - wx) * (1 - wy), wx * (1 - wy),
+        (1 - wx) * wy, wx * wy};
+
+    for (size_t c = 0; c < depth; c++)
+    {
+      double value = 0.0;
+      for (size_t k = 0; k < 4; k++)
+      {
+        const long px = ix + (long) (k % 2), py = iy + (long) (k / 2);
+        if (px >= 0 && py >= 0 && px < (long) width && py < (long) height)
+          value += weights[k] * image[(py * width + px) * depth + c];
+      }
+
+      output[c] = std::is_integral<ElemType>::value ?
+          (ElemType) std::round(value) : (ElemType) value;
+    }
+  }
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
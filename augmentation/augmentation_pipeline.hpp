@@ -0,0 +1,273 @@
+/**
+ * @file augmentation_pipeline.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of AugmentationPipeline class that compiles augmentation
+ * strings into operations applied in a single pass per image.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_AUGMENTATION_AUGMENTATION_PIPELINE_HPP
+#define MODELS_AUGMENTATION_AUGMENTATION_PIPELINE_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/util/to_lower.hpp>
+#include <augmentation/augmentation_kernels.hpp>
+#include <augmentation/bilinear_resize.hpp>
+#include <utils/utils.hpp>
+#include <boost/regex.hpp>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Augmentation strings compiled into typed operations. Neighbouring
+ * operations are fused into stages, and all stages are applied to one image
+ * before moving on to the next image, so every image is read and written
+ * once while it's in cache:
+ *
+ *  - Resize and flips are fused into one resampling pass. Interpolation
+ *    tables of BilinearResize are computed once, when the pipeline is
+ *    compiled. "letterbox (width, height, pad)" resizes without changing
+ *    the aspect ratio and pads the border with pad, 0 by default.
+ *  - "scale (s)", "normalize (mean, std)" and "channel-order (2, 1, 0)" are
+ *    fused into a single per-pixel affine map. Normalize takes either one
+ *    mean and standard deviation, or one of each per channel. These
+ *    operations are always applied.
+ *  - Other augmentations are looked up in AugmentationKernels::Registry().
+ *
+ * Flips and kernels are applied to each image with the augmentation
+ * probability.
+ *
+ * @code
+ * AugmentationPipeline pipeline({"resize (32, 32)", "horizontal-flip",
+ *     "normalize (127.5, 127.5)"}, 0.5, 64, 64, 3);
+ * pipeline.Apply(images);
+ * @endcode
+ */
+class AugmentationPipeline
+{
+ public:
+  //! Create an empty pipeline.
+  AugmentationPipeline() :
+      augmentationProbability(0.0),
+      inputWidth(0),
+      inputHeight(0),
+      depth(0),
+      outputWidth(0),
+      outputHeight(0)
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Compiles augmentation strings into a pipeline.
+   *
+   * @param augmentations Augmentations in the order they are applied.
+   * @param augmentationProbability Probability of applying a random
+   *     augmentation to an image.
+   * @param inputWidth Width of input images.
+   * @param inputHeight Height of input images.
+   * @param depth Number of channels of images.
+   */
+  AugmentationPipeline(const std::vector<std::string>& augmentations,
+                       const double augmentationProbability,
+                       const size_t inputWidth,
+                       const size_t inputHeight,
+                       const size_t depth);
+
+  /**
+   * Applies the pipeline to every image of a dataset in parallel, using a
+   * random seed.
+   *
+   * @param input Images that will be augmented, one per column.
+   * @param output Matrix where augmented images will be stored. It must not
+   *     be the same matrix as input.
+   */
+  template<typename MatType>
+  void Apply(const MatType& input, MatType& output) const;
+
+  /**
+   * Applies the pipeline to every image of a dataset in parallel. Each image
+   * draws random numbers from its own generator, seeded with the seed and
+   * the stream of the image, so the result doesn't depend on the number of
+   * threads or on the other images of the dataset.
+   *
+   * @param input Images that will be augmented, one per column.
+   * @param output Matrix where augmented images will be stored. It must not
+   *     be the same matrix as input.
+   * @param seed Seed shared by all images.
+   * @param streams Stream of each image, such as the index of the data point
+   *     in its set. If empty, the stream of an image is its column.
+   * @param numThreads Number of threads used. If 0, all threads available to
+   *     OpenMP are used.
+   */
+  template<typename MatType>
+  void Apply(const MatType& input,
+             MatType& output,
+             const size_t seed,
+             const arma::uvec& streams = arma::uvec(),
+             const size_t numThreads = 0) const;
+
+  /**
+   * Applies the pipeline to every image of a dataset in parallel, using a
+   * random seed.
+   *
+   * @param dataset Images that will be augmented, one per column.
+   */
+  template<typename MatType>
+  void Apply(MatType& dataset) const;
+
+  /**
+   * Applies the pipeline to every image of a dataset in parallel. See
+   * Apply(input, output, seed, streams).
+   *
+   * @param dataset Images that will be augmented, one per column.
+   * @param seed Seed shared by all images.
+   * @param streams Stream of each image. If empty, the stream of an image is
+   *     its column.
+   * @param numThreads Number of threads used. If 0, all threads available to
+   *     OpenMP are used.
+   */
+  template<typename MatType>
+  void Apply(MatType& dataset,
+             const size_t seed,
+             const arma::uvec& streams = arma::uvec(),
+             const size_t numThreads = 0) const;
+
+  //! Get whether the pipeline has no stages.
+  bool Empty() const { return stages.empty(); }
+
+  //! Get the width of output images.
+  size_t OutputWidth() const { return outputWidth; }
+
+  //! Get the height of output images.
+  size_t OutputHeight() const { return outputHeight; }
+
+  //! Get the number of channels of images.
+  size_t Depth() const { return depth; }
+
+  /**
+   * Get the name of an augmentation i.e. the part of the augmentation string
+   * before any parameters.
+   *
+   * @param augmentation String containing the transform.
+   */
+  static std::string Name(const std::string& augmentation)
+  {
+    return augmentation.substr(0, augmentation.find_first_of(" (=:{[,"));
+  }
+
+  /**
+   * Get the numbers given after the name of an augmentation.
+   *
+   * @param augmentation String containing the transform.
+   */
+  static std::vector<double> Params(const std::string& augmentation)
+  {
+    static const boost::regex regex{"-?[0-9]*\\.?[0-9]+"};
+    const std::string params = augmentation.substr(
+        Name(augmentation).length());
+
+    std::vector<double> values;
+    boost::sregex_token_iterator matches(params.begin(), params.end(), regex,
+        0), end;
+    for (; matches != end; ++matches)
+      values.push_back(std::stod(*matches));
+
+    return values;
+  }
+
+ private:
+  //! Types of stages.
+  enum StageType
+  {
+    Resample,
+    Kernel,
+    Pixel
+  };
+
+  //! Operations fused into a single pass over an image.
+  struct Stage
+  {
+    //! Create a stage that doesn't change the image.
+    Stage() :
+        type(Resample),
+        width(0),
+        height(0),
+        identity(true),
+        horizontalFlip(false),
+        verticalFlip(false)
+    {
+      // Nothing to do here.
+    }
+
+    StageType type;
+
+    //! Resample: size of the output and the resize to it.
+    size_t width, height;
+    BilinearResize resize;
+    bool identity;
+
+    //! Resample: whether random horizontal and vertical flips are applied.
+    bool horizontalFlip, verticalFlip;
+
+    //! Kernel: name and parameters of the kernel.
+    std::string name;
+    std::vector<double> params;
+
+    //! Pixel: channel c of the output is channel order[c] of the input
+    //! times scale[c] plus shift[c].
+    std::vector<size_t> order;
+    std::vector<double> scale, shift;
+  };
+
+  //! Get the resample stage at the end of the pipeline, adding one if the
+  //! last stage isn't a resample stage or append is true.
+  Stage& LastResampleStage(const bool append = false);
+
+  //! Get the pixel stage at the end of the pipeline, adding one if the last
+  //! stage isn't a pixel stage.
+  Stage& LastPixelStage();
+
+  //! Applies a resample stage to an image, using row as the row buffer of
+  //! the resize.
+  template<typename ElemType, typename AccType>
+  void ApplyResample(const Stage& stage,
+                     const ElemType* input,
+                     ElemType* output,
+                     AccType* row,
+                     const bool flipX,
+                     const bool flipY) const;
+
+  //! Applies a pixel stage to an image, input and output may be the same.
+  //! pixel is a scratch buffer holding the depth channels of one pixel.
+  template<typename ElemType>
+  void ApplyPixel(const Stage& stage,
+                  const ElemType* input,
+                  ElemType* output,
+                  double* pixel,
+                  const size_t pixels) const;
+
+  //! Locally stored probability of applying a random augmentation.
+  double augmentationProbability;
+
+  //! Locally stored size of input images.
+  size_t inputWidth, inputHeight, depth;
+
+  //! Locally stored size of output images.
+  size_t outputWidth, outputHeight;
+
+  //! Locally stored stages of the pipeline.
+  std::vector<Stage> stages;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#include "augmentation_pipeline_impl.hpp" // Include implementation.
+
+#endif
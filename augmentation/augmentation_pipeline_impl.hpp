@@ -0,0 +1,371 @@
+/**
+ * @file augmentation_pipeline_impl.hpp
+ * @author Kartik Dutt
+ *
+ * Implementation of AugmentationPipeline class.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_AUGMENTATION_AUGMENTATION_PIPELINE_IMPL_HPP
+#define MODELS_AUGMENTATION_AUGMENTATION_PIPELINE_IMPL_HPP
+
+// Incase it has not been included already.
+#include "augmentation_pipeline.hpp"
+
+namespace mlpack {
+namespace models {
+
+inline AugmentationPipeline::AugmentationPipeline(
+    const std::vector<std::string>& augmentations,
+    const double augmentationProbability,
+    const size_t inputWidth,
+    const size_t inputHeight,
+    const size_t depth) :
+    augmentationProbability(augmentationProbability),
+    inputWidth(inputWidth),
+    inputHeight(inputHeight),
+    depth(depth),
+    outputWidth(inputWidth),
+    outputHeight(inputHeight)
+{
+  for (size_t i = 0; i < augmentations.size(); i++)
+  {
+    const std::string augmentation = mlpack::util::ToLower(augmentations[i]);
+    const std::string name = Name(augmentation);
+    const std::vector<double> params = Params(augmentation);
+
+    if (name.find("resize") != std::string::npos || name == "letterbox")
+    {
+      if (params.empty())
+      {
+        mlpack::Log::Fatal << "Invalid size / shape in " << augmentation
+            << std::endl;
+      }
+
+      // If only one number is given, width and height are equal.
+      const size_t width = (size_t) params[0];
+      const size_t height = params.size() > 1 ? (size_t) params[1] : width;
+
+      // Flips are applied after resizing, so a resize can't be added to a
+      // stage that flips.
+      Stage* stage = &LastResampleStage();
+      if (!stage->identity || stage->horizontalFlip || stage->verticalFlip)
+        stage = &LastResampleStage(true);
+
+      stage->resize = (name == "letterbox") ?
+          BilinearResize::Letterbox(outputWidth, outputHeight, width, height,
+          depth, params.size() > 2 ? params[2] : 0.0) :
+          BilinearResize(outputWidth, outputHeight, width, height, depth);
+      stage->identity = stage->resize.Identity();
+      stage->width = outputWidth = width;
+      stage->height = outputHeight = height;
+    }
+    else if (name == "horizontal-flip" || name == "vertical-flip")
+    {
+      // Each flip is drawn independently, so a repeated flip needs its own
+      // stage.
+      const bool horizontal = (name == "horizontal-flip");
+      Stage* stage = &LastResampleStage();
+      if (horizontal ? stage->horizontalFlip : stage->verticalFlip)
+        stage = &LastResampleStage(true);
+
+      (horizontal ? stage->horizontalFlip : stage->verticalFlip) = true;
+    }
+    else if (name == "scale")
+    {
+      Stage& stage = LastPixelStage();
+      const double scale = params.empty() ? 1.0 : params[0];
+      for (size_t c = 0; c < depth; c++)
+      {
+        stage.scale[c] *= scale;
+        stage.shift[c] *= scale;
+      }
+    }
+    else if (name == "normalize")
+    {
+      if (params.size() != 2 && params.size() != 2 * depth)
+      {
+        mlpack::Log::Fatal << "Normalize takes a mean and a standard "
+            << "deviation, or one of each per channel: " << augmentation
+            << std::endl;
+      }
+
+      Stage& stage = LastPixelStage();
+      const size_t channels = params.size() / 2;
+      for (size_t c = 0; c < depth; c++)
+      {
+        const double mean = params[c % channels];
+        const double deviation = params[channels + c % channels];
+        stage.scale[c] /= deviation;
+        stage.shift[c] = (stage.shift[c] - mean) / deviation;
+      }
+    }
+    else if (name == "channel-order")
+    {
+      std::vector<size_t> order;
+      for (size_t c = 0; c < params.size(); c++)
+        order.push_back(params[c] < 0 ? depth : (size_t) params[c]);
+
+      std::vector<size_t> sorted(order);
+      std::sort(sorted.begin(), sorted.end());
+      for (size_t c = 0; c < sorted.size(); c++)
+      {
+        if (sorted.size() != depth || sorted[c] != c)
+        {
+          mlpack::Log::Fatal << "Channel order must be a permutation of the "
+              << depth << " channels: " << augmentation << std::endl;
+        }
+      }
+
+      Stage& stage = LastPixelStage();
+      const Stage previous = stage;
+      for (size_t c = 0; c < depth; c++)
+      {
+        stage.order[c] = previous.order[order[c]];
+        stage.scale[c] = previous.scale[order[c]];
+        stage.shift[c] = previous.shift[order[c]];
+      }
+    }
+    else
+    {
+      // Kernels are looked up when the pipeline is applied, as they depend
+      // on the element type.
+      Stage stage;
+      stage.type = Kernel;
+      stage.name = name;
+      stage.params = params;
+      stages.push_back(stage);
+    }
+  }
+}
+
+template<typename MatType>
+void AugmentationPipeline::Apply(const MatType& input, MatType& output) const
+{
+  Apply(input, output, mlpack::math::RandInt(1 << 30));
+}
+
+template<typename MatType>
+void AugmentationPipeline::Apply(const MatType& input,
+                                 MatType& output,
+                                 const size_t seed,
+                                 const arma::uvec& streams,
+                                 const size_t numThreads) const
+{
+  typedef typename MatType::elem_type ElemType;
+  typedef typename AugmentationKernels<ElemType>::KernelType KernelType;
+
+  if (input.n_cols == 0)
+  {
+    output.set_size(outputWidth * outputHeight * depth, 0);
+    return;
+  }
+
+  mlpack::Log::Assert(input.n_rows == inputWidth * inputHeight * depth,
+      "Shape of images doesn't match the number of rows.");
+  mlpack::Log::Assert(streams.n_elem == 0 || streams.n_elem == input.n_cols,
+      "Number of streams doesn't match the number of images.");
+
+  if (stages.empty())
+  {
+    output = input;
+    return;
+  }
+
+  // Find kernels and the largest intermediate image.
+  std::vector<KernelType> kernels(stages.size(), nullptr);
+  size_t bufferSize = input.n_rows, rowSize = 0;
+  for (size_t s = 0; s < stages.size(); s++)
+  {
+    if (stages[s].type == Resample)
+    {
+      bufferSize = std::max(bufferSize, stages[s].width * stages[s].height *
+          depth);
+      rowSize = std::max(rowSize, stages[s].resize.RowSize());
+    }
+    else if (stages[s].type == Kernel)
+    {
+      kernels[s] = AugmentationKernels<ElemType>::Find(stages[s].name);
+      if (kernels[s] == nullptr)
+      {
+        mlpack::Log::Warn << "Unknown augmentation : \'" << stages[s].name
+            << "\' not found!" << std::endl;
+      }
+    }
+  }
+
+  output.set_size(outputWidth * outputHeight * depth, input.n_cols);
+
+  #pragma omp parallel num_threads(Utils::NumThreads(numThreads))
+  {
+    std::vector<ElemType> first(bufferSize), second(bufferSize),
+        scratch(bufferSize);
+    std::vector<BilinearResize::AccumulatorType<ElemType>> row(rowSize);
+    std::vector<double> pixel(depth);
+
+    #pragma omp for schedule(static)
+    for (omp_size_t col = 0; col < (omp_size_t) input.n_cols; col++)
+    {
+      const uint64_t stream = streams.n_elem > 0 ? streams(col) : col;
+      std::seed_seq sequence{(uint32_t) seed, (uint32_t) ((uint64_t) seed >>
+          32), (uint32_t) stream, (uint32_t) (stream >> 32)};
+      std::mt19937 generator(sequence);
+      std::uniform_real_distribution<double> probability(0.0, 1.0);
+
+      // The first stage reads the input column and the last stage writes the
+      // output column, other stages alternate between two buffers.
+      const ElemType* source = input.colptr(col);
+      size_t width = inputWidth, height = inputHeight;
+      for (size_t s = 0; s < stages.size(); s++)
+      {
+        const Stage& stage = stages[s];
+        ElemType* target = (s + 1 == stages.size()) ? output.colptr(col) :
+            (source == first.data() ? second.data() : first.data());
+
+        if (stage.type == Resample)
+        {
+          const bool flipX = stage.horizontalFlip &&
+              probability(generator) < augmentationProbability;
+          const bool flipY = stage.verticalFlip &&
+              probability(generator) < augmentationProbability;
+          ApplyResample(stage, source, target, row.data(), flipX, flipY);
+          width = stage.width;
+          height = stage.height;
+        }
+        else if (stage.type == Kernel)
+        {
+          if (target != source)
+            std::copy(source, source + width * height * depth, target);
+
+          if (kernels[s] != nullptr &&
+              probability(generator) < augmentationProbability)
+          {
+            kernels[s](target, width, height, depth, stage.params, generator,
+                scratch.data());
+          }
+        }
+        else
+        {
+          ApplyPixel(stage, source, target, pixel.data(), width * height);
+        }
+
+        source = target;
+      }
+    }
+  }
+}
+
+template<typename MatType>
+void AugmentationPipeline::Apply(MatType& dataset) const
+{
+  Apply(dataset, mlpack::math::RandInt(1 << 30));
+}
+
+template<typename MatType>
+void AugmentationPipeline::Apply(MatType& dataset,
+                                 const size_t seed,
+                                 const arma::uvec& streams,
+                                 const size_t numThreads) const
+{
+  if (stages.empty())
+    return;
+
+  MatType output;
+  Apply(dataset, output, seed, streams, numThreads);
+  dataset = std::move(output);
+}
+
+inline AugmentationPipeline::Stage& AugmentationPipeline::LastResampleStage(
+    const bool append)
+{
+  if (append || stages.empty() || stages.back().type != Resample)
+  {
+    // A new stage doesn't resize.
+    Stage stage;
+    stage.width = outputWidth;
+    stage.height = outputHeight;
+    stage.resize = BilinearResize(outputWidth, outputHeight, outputWidth,
+        outputHeight, depth);
+    stages.push_back(stage);
+  }
+
+  return stages.back();
+}
+
+inline AugmentationPipeline::Stage& AugmentationPipeline::LastPixelStage()
+{
+  if (stages.empty() || stages.back().type != Pixel)
+  {
+    Stage stage;
+    stage.type = Pixel;
+    for (size_t c = 0; c < depth; c++)
+      stage.order.push_back(c);
+
+    stage.scale.assign(depth, 1.0);
+    stage.shift.assign(depth, 0.0);
+    stages.push_back(stage);
+  }
+
+  return stages.back();
+}
+
+template<typename ElemType, typename AccType>
+void AugmentationPipeline::ApplyResample(const Stage& stage,
+                                         const ElemType* input,
+                                         ElemType* output,
+                                         AccType* row,
+                                         const bool flipX,
+                                         const bool flipY) const
+{
+  if (!stage.identity)
+  {
+    stage.resize.Resize(input, output, row, flipX, flipY);
+    return;
+  }
+
+  // Flips without a resize only move pixels.
+  const size_t rowSize = stage.width * depth;
+  for (size_t y = 0; y < stage.height; y++)
+  {
+    const ElemType* inRow = input + y * rowSize;
+    ElemType* outRow = output + (flipY ? stage.height - 1 - y : y) * rowSize;
+    if (!flipX)
+    {
+      std::copy(inRow, inRow + rowSize, outRow);
+      continue;
+    }
+
+    for (size_t x = 0; x < stage.width; x++)
+    {
+      std::copy(inRow + x * depth, inRow + (x + 1) * depth,
+          outRow + (stage.width - 1 - x) * depth);
+    }
+  }
+}
+
+template<typename ElemType>
+void AugmentationPipeline::ApplyPixel(const Stage& stage,
+                                      const ElemType* input,
+                                      ElemType* output,
+                                      double* pixel,
+                                      const size_t pixels) const
+{
+  for (size_t p = 0; p < pixels; p++)
+  {
+    const ElemType* in = input + p * depth;
+    for (size_t c = 0; c < depth; c++)
+      pixel[c] = in[stage.order[c]] * stage.scale[c] + stage.shift[c];
+
+    ElemType* out = output + p * depth;
+    for (size_t c = 0; c < depth; c++)
+      out[c] = BilinearResize::Cast<ElemType>(pixel[c]);
+  }
+}
+
+} // namespace models
+} // namespace mlpack
+
+#endif
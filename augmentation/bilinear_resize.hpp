@@ -0,0 +1,489 @@
+/**
+ * @file bilinear_resize.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of BilinearResize class for resizing images with precomputed
+ * interpolation tables.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_AUGMENTATION_BILINEAR_RESIZE_HPP
+#define MODELS_AUGMENTATION_BILINEAR_RESIZE_HPP
+
+#include <mlpack/prereqs.hpp>
+#include <utils/utils.hpp>
+#include <algorithm>
+#include <type_traits>
+#include <limits>
+#include <cmath>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Bilinear resize of images stored in the interleaved layout used by
+ * mlpack::data::Load(), i.e. channel c of pixel (x, y) is at index
+ * (y * width + x) * depth + c. Pixels are sampled like
+ * mlpack::ann::BilinearInterpolation, but all channels of a pixel are
+ * interpolated together.
+ *
+ * Interpolation tables are computed once per pair of input and output sizes.
+ * Each output row first blends two input rows into a row buffer, which is a
+ * contiguous loop that is vectorized, and then interpolates between
+ * neighbouring pixels of the buffer, which gathers pixels at precomputed
+ * offsets and is scalar. Images that aren't stored as doubles are
+ * interpolated in single precision, so twice as many values fit in a vector
+ * register.
+ *
+ * A letterbox resize scales images uniformly so that they fit the output,
+ * and fills the remaining border with a constant. Padding is written in the
+ * same pass as the resized pixels, so no intermediate image is allocated.
+ * ScaleX(), ScaleY(), OffsetX() and OffsetY() map coordinates between the
+ * input and the output, e.g. to map predicted boxes back to the input image.
+ *
+ * @code
+ * BilinearResize resize(64, 64, 32, 32, 3);
+ * resize.Apply(images);
+ *
+ * // Fit 640 x 480 images into 416 x 416 images, padding with 0.5.
+ * BilinearResize letterbox = BilinearResize::Letterbox(640, 480, 416, 416, 3,
+ *     0.5);
+ * letterbox.Apply(images);
+ * const double sourceX = letterbox.ToSourceX(predictedX);
+ * @endcode
+ */
+class BilinearResize
+{
+ public:
+  //! Type used to interpolate elements of type ElemType.
+  template<typename ElemType>
+  using AccumulatorType = typename std::conditional<
+      std::is_same<ElemType, double>::value, double, float>::type;
+
+  //! Create an empty resize.
+  BilinearResize() :
+      inputWidth(0),
+      inputHeight(0),
+      outputWidth(0),
+      outputHeight(0),
+      depth(0),
+      regionX(0),
+      regionY(0),
+      regionWidth(0),
+      regionHeight(0),
+      padValue(0.0)
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Computes interpolation tables for resizing images.
+   *
+   * @param inputWidth Width of input images.
+   * @param inputHeight Height of input images.
+   * @param outputWidth Width of resized images.
+   * @param outputHeight Height of resized images.
+   * @param depth Number of channels of images.
+   */
+  BilinearResize(const size_t inputWidth,
+                 const size_t inputHeight,
+                 const size_t outputWidth,
+                 const size_t outputHeight,
+                 const size_t depth) :
+      inputWidth(inputWidth),
+      inputHeight(inputHeight),
+      outputWidth(outputWidth),
+      outputHeight(outputHeight),
+      depth(depth),
+      regionX(0),
+      regionY(0),
+      regionWidth(outputWidth),
+      regionHeight(outputHeight),
+      padValue(0.0)
+  {
+    Tables();
+  }
+
+  /**
+   * Computes interpolation tables for resizing images while preserving their
+   * aspect ratio. Images are scaled uniformly to the largest size that fits
+   * the output, centered, and the border is filled with padValue.
+   *
+   * @param inputWidth Width of input images.
+   * @param inputHeight Height of input images.
+   * @param outputWidth Width of resized images, including the padding.
+   * @param outputHeight Height of resized images, including the padding.
+   * @param depth Number of channels of images.
+   * @param padValue Value of every element of the padding.
+   */
+  static BilinearResize Letterbox(const size_t inputWidth,
+                                  const size_t inputHeight,
+                                  const size_t outputWidth,
+                                  const size_t outputHeight,
+                                  const size_t depth,
+                                  const double padValue = 0.0)
+  {
+    BilinearResize resize;
+    resize.inputWidth = inputWidth;
+    resize.inputHeight = inputHeight;
+    resize.outputWidth = outputWidth;
+    resize.outputHeight = outputHeight;
+    resize.depth = depth;
+    resize.padValue = padValue;
+
+    // The side that fits the output tightly isn't padded.
+    const double scale = std::min((double) outputWidth / inputWidth,
+        (double) outputHeight / inputHeight);
+    resize.regionWidth = std::min(outputWidth, std::max<size_t>(1,
+        (size_t) std::round(inputWidth * scale)));
+    resize.regionHeight = std::min(outputHeight, std::max<size_t>(1,
+        (size_t) std::round(inputHeight * scale)));
+    resize.regionX = (outputWidth - resize.regionWidth) / 2;
+    resize.regionY = (outputHeight - resize.regionHeight) / 2;
+    resize.Tables();
+    return resize;
+  }
+
+  /**
+   * Resizes a single image, optionally mirroring the output.
+   *
+   * @param input Pointer to the first element of the input image.
+   * @param output Pointer to the first element of the resized image. It must
+   *     not overlap the input.
+   * @param row Buffer with at least RowSize() elements.
+   * @param flipX Whether the resized image is mirrored horizontally.
+   * @param flipY Whether the resized image is mirrored vertically.
+   */
+  template<typename ElemType, typename AccType>
+  void Resize(const ElemType* input,
+              ElemType* output,
+              AccType* row,
+              const bool flipX = false,
+              const bool flipY = false) const
+  {
+    const size_t rowSize = RowSize();
+    const size_t outRowSize = outputWidth * depth;
+    const ElemType pad = Cast<ElemType>(padValue);
+
+    // Position of the resized image in the output, after flipping.
+    const size_t firstX = flipX ? outputWidth - regionX - regionWidth :
+        regionX;
+    const size_t firstY = flipY ? outputHeight - regionY - regionHeight :
+        regionY;
+
+    // Padding rows above and below the resized image.
+    std::fill(output, output + firstY * outRowSize, pad);
+    std::fill(output + (firstY + regionHeight) * outRowSize,
+        output + outputHeight * outRowSize, pad);
+
+    for (size_t y = 0; y < regionHeight; y++)
+    {
+      // Blend the two input rows.
+      const ElemType* row0 = input + yOrigin[y];
+      const ElemType* row1 = input + yNext[y];
+      const AccType wy = (AccType) yWeight[y];
+      #pragma omp simd
+      for (size_t i = 0; i < rowSize; i++)
+        row[i] = row0[i] + wy * ((AccType) row1[i] - (AccType) row0[i]);
+
+      ElemType* outRow = output + (firstY + (flipY ? regionHeight - 1 - y :
+          y)) * outRowSize;
+
+      // Padding on the left and right of the resized image.
+      std::fill(outRow, outRow + firstX * depth, pad);
+      std::fill(outRow + (firstX + regionWidth) * depth, outRow + outRowSize,
+          pad);
+
+      // Blend neighbouring pixels of the row.
+      for (size_t x = 0; x < regionWidth; x++)
+      {
+        const AccType* pixel0 = row + xOrigin[x];
+        const AccType* pixel1 = row + xNext[x];
+        const AccType wx = (AccType) xWeight[x];
+        ElemType* pixel = outRow + (firstX + (flipX ? regionWidth - 1 - x :
+            x)) * depth;
+        for (size_t c = 0; c < depth; c++)
+          pixel[c] = Cast<ElemType>(pixel0[c] + wx * (pixel1[c] - pixel0[c]));
+      }
+    }
+  }
+
+  /**
+   * Resizes every image of a dataset in parallel.
+   *
+   * @param input Images that will be resized, one per column.
+   * @param output Matrix where resized images will be stored. It must not be
+   *     the same matrix as input.
+   * @param numThreads Number of threads used. If 0, all threads available to
+   *     OpenMP are used.
+   */
+  template<typename MatType>
+  void Apply(const MatType& input,
+             MatType& output,
+             const size_t numThreads = 0) const
+  {
+    typedef typename MatType::elem_type ElemType;
+
+    if (input.n_cols == 0)
+    {
+      output.set_size(outputWidth * outputHeight * depth, 0);
+      return;
+    }
+
+    mlpack::Log::Assert(input.n_rows == inputWidth * inputHeight * depth,
+        "Shape of images doesn't match the number of rows.");
+
+    output.set_size(outputWidth * outputHeight * depth, input.n_cols);
+
+    #pragma omp parallel num_threads(Utils::NumThreads(numThreads))
+    {
+      std::vector<AccumulatorType<ElemType>> row(RowSize());
+
+      #pragma omp for schedule(static)
+      for (omp_size_t col = 0; col < (omp_size_t) input.n_cols; col++)
+        Resize(input.colptr(col), output.colptr(col), row.data());
+    }
+  }
+
+  /**
+   * Resizes every image of a dataset in parallel, in place. Images that
+   * don't grow are resized in blocks of one image per thread into a scratch
+   * buffer, and packed into the leading memory of the dataset. The packed
+   * images of a block end before the images of the next block start, so only
+   * images that were already resized are overwritten. The dataset then keeps
+   * its memory if Armadillo allows it, see ShrinkRows(), so no second dataset
+   * is allocated. Images that grow need more memory, so they're resized into
+   * a new matrix.
+   *
+   * @param dataset Images that will be resized, one per column.
+   * @param numThreads Number of threads used. If 0, all threads available to
+   *     OpenMP are used.
+   */
+  template<typename MatType>
+  void Apply(MatType& dataset, const size_t numThreads = 0) const
+  {
+    typedef typename MatType::elem_type ElemType;
+
+    const size_t inputSize = inputWidth * inputHeight * depth;
+    const size_t outputSize = outputWidth * outputHeight * depth;
+    if (dataset.n_cols == 0)
+    {
+      dataset.set_size(outputSize, 0);
+      return;
+    }
+
+    mlpack::Log::Assert(dataset.n_rows == inputSize,
+        "Shape of images doesn't match the number of rows.");
+
+    if (outputSize > inputSize)
+    {
+      MatType output;
+      Apply(dataset, output, numThreads);
+      dataset = std::move(output);
+      return;
+    }
+
+    const size_t cols = dataset.n_cols;
+    const size_t blockSize = std::min<size_t>(cols,
+        Utils::NumThreads(numThreads));
+    std::vector<ElemType> scratch(blockSize * outputSize);
+    ElemType* memory = dataset.memptr();
+
+    #pragma omp parallel num_threads(Utils::NumThreads(numThreads))
+    {
+      std::vector<AccumulatorType<ElemType>> row(RowSize());
+
+      for (size_t first = 0; first < cols; first += blockSize)
+      {
+        const size_t size = std::min(blockSize, cols - first);
+
+        #pragma omp for schedule(static)
+        for (omp_size_t i = 0; i < (omp_size_t) size; i++)
+        {
+          Resize(memory + (first + (size_t) i) * inputSize,
+              scratch.data() + (size_t) i * outputSize, row.data());
+        }
+
+        #pragma omp for schedule(static)
+        for (omp_size_t i = 0; i < (omp_size_t) size; i++)
+        {
+          const ElemType* image = scratch.data() + (size_t) i * outputSize;
+          std::copy(image, image + outputSize,
+              memory + (first + (size_t) i) * outputSize);
+        }
+      }
+    }
+
+    ShrinkRows(dataset, outputSize);
+  }
+
+  //! Get the number of elements of the row buffer.
+  size_t RowSize() const { return inputWidth * depth; }
+
+  //! Get whether the output is the unpadded input.
+  bool Identity() const
+  {
+    return inputWidth == outputWidth && inputHeight == outputHeight &&
+        regionWidth == outputWidth && regionHeight == outputHeight;
+  }
+
+  //! Get the width of input images.
+  size_t InputWidth() const { return inputWidth; }
+
+  //! Get the height of input images.
+  size_t InputHeight() const { return inputHeight; }
+
+  //! Get the width of resized images.
+  size_t OutputWidth() const { return outputWidth; }
+
+  //! Get the height of resized images.
+  size_t OutputHeight() const { return outputHeight; }
+
+  //! Get the number of channels of images.
+  size_t Depth() const { return depth; }
+
+  //! Get the horizontal scale from input to output coordinates.
+  double ScaleX() const { return (double) regionWidth / inputWidth; }
+
+  //! Get the vertical scale from input to output coordinates.
+  double ScaleY() const { return (double) regionHeight / inputHeight; }
+
+  //! Get the width of the padding on the left of the resized image.
+  size_t OffsetX() const { return regionX; }
+
+  //! Get the height of the padding above the resized image.
+  size_t OffsetY() const { return regionY; }
+
+  //! Get the value of the padding.
+  double PadValue() const { return padValue; }
+
+  //! Maps a horizontal input coordinate to the output.
+  double ToOutputX(const double x) const { return x * ScaleX() + regionX; }
+
+  //! Maps a vertical input coordinate to the output.
+  double ToOutputY(const double y) const { return y * ScaleY() + regionY; }
+
+  //! Maps a horizontal output coordinate, such as a prediction, to the input.
+  double ToSourceX(const double x) const { return (x - regionX) / ScaleX(); }
+
+  //! Maps a vertical output coordinate, such as a prediction, to the input.
+  double ToSourceY(const double y) const { return (y - regionY) / ScaleY(); }
+
+  //! Converts an interpolated value to the element type. For integral types
+  //! the value is clamped to the range of the type and rounded, so that out
+  //! of range values saturate instead of overflowing.
+  template<typename ElemType, typename AccType>
+  static ElemType Cast(const AccType value)
+  {
+    if (!std::is_integral<ElemType>::value)
+      return (ElemType) value;
+
+    const AccType lowest = (AccType) std::numeric_limits<ElemType>::lowest();
+    const AccType highest = (AccType) std::numeric_limits<ElemType>::max();
+    return (ElemType) std::round(std::min(std::max(value, lowest), highest));
+  }
+
+ private:
+  /**
+   * Reshapes a matrix whose leading elements hold packed columns of rows
+   * elements into a matrix of such columns. Armadillo keeps the memory, and so the elements, of a
+   * matrix whose new size is more than half of its allocation and doesn't
+   * fit its local buffer. Otherwise the packed columns are copied into a new
+   * matrix, which is at most half the size of the old one.
+   *
+   * @param dataset Matrix whose leading elements hold the packed columns.
+   * @param rows Number of elements of a packed column.
+   */
+  template<typename MatType>
+  static void ShrinkRows(MatType& dataset, const size_t rows)
+  {
+    const size_t cols = dataset.n_cols;
+    const size_t elems = rows * cols;
+    if (rows == dataset.n_rows)
+      return;
+
+    if (dataset.mem_state == 0 && elems > arma::arma_config::mat_prealloc &&
+        2 * elems > dataset.n_alloc)
+    {
+      const typename MatType::elem_type* memory = dataset.memptr();
+      dataset.set_size(rows, cols);
+      mlpack::Log::Assert(dataset.memptr() == memory,
+          "Shrinking the dataset moved its memory.");
+    }
+    else
+    {
+      dataset = MatType(dataset.memptr(), rows, cols);
+    }
+  }
+
+  //! Computes the interpolation tables from the input to the resized region.
+  void Tables()
+  {
+    Table(inputWidth, regionWidth, depth, xOrigin, xNext, xWeight);
+    Table(inputHeight, regionHeight, inputWidth * depth, yOrigin, yNext,
+        yWeight);
+  }
+
+  /**
+   * Computes the interpolation table of one axis. Output position i blends
+   * input positions origin[i] and next[i], scaled by stride, with weight[i]
+   * of the second one.
+   */
+  static void Table(const size_t inSize,
+                    const size_t outSize,
+                    const size_t stride,
+                    std::vector<size_t>& origin,
+                    std::vector<size_t>& next,
+                    std::vector<double>& weight)
+  {
+    origin.resize(outSize);
+    next.resize(outSize);
+    weight.resize(outSize);
+
+    const double scale = (double) inSize / (double) outSize;
+    for (size_t i = 0; i < outSize; i++)
+    {
+      size_t o = (size_t) std::floor(i * scale);
+      if (inSize < 2)
+        o = 0;
+      else if (o > inSize - 2)
+        o = inSize - 2;
+
+      origin[i] = o * stride;
+      next[i] = std::min(o + 1, inSize - 1) * stride;
+      weight[i] = (inSize < 2) ? 0.0 : std::min(i * scale - o, 1.0);
+    }
+  }
+
+  //! Locally stored size of input images.
+  size_t inputWidth, inputHeight;
+
+  //! Locally stored size of resized images.
+  size_t outputWidth, outputHeight;
+
+  //! Locally stored number of channels.
+  size_t depth;
+
+  //! Locally stored position and size of the resized image in the output.
+  //! The rest of the output is padding.
+  size_t regionX, regionY, regionWidth, regionHeight;
+
+  //! Locally stored value of the padding.
+  double padValue;
+
+  //! Locally stored offsets and weights of the columns of each output pixel.
+  std::vector<size_t> xOrigin, xNext;
+  std::vector<double> xWeight;
+
+  //! Locally stored offsets and weights of the rows of each output row.
+  std::vector<size_t> yOrigin, yNext;
+  std::vector<double> yWeight;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
@@ -0,0 +1,478 @@
+/**
+ * @file detection_augmentation.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of DetectionAugmentation class that applies geometric
+ * augmentations to images and their bounding boxes together.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_AUGMENTATION_DETECTION_AUGMENTATION_HPP
+#define MODELS_AUGMENTATION_DETECTION_AUGMENTATION_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/util/to_lower.hpp>
+#include <augmentation/augmentation_pipeline.hpp>
+#include <augmentation/bilinear_resize.hpp>
+#include <utils/utils.hpp>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Geometric augmentations of object detection datasets. Bounding boxes are
+ * stored as class, x1, y1, x2, y2 in pixels of the image, as loaded by
+ * DataLoader::LoadObjectDetectionDataset(). Supported augmentations are:
+ *
+ *  - "horizontal-flip", "vertical-flip"
+ *  - "random-resized-crop (minScale)": crops a random window whose sides
+ *    are at least minScale (default 0.5, at most 1) times the sides of the
+ *    image, and scales it back to the size of the image. Unlike
+ *    "random-crop (pad)" of Augmentation, the parameter is a scale.
+ *  - "scale-jitter (min, max)": scales the image around its center by a
+ *    random factor between min and max (default 0.75 and 1.25).
+ *  - "translate (fraction)": shifts the image by up to fraction (default 0.1)
+ *    of its width and height.
+ *
+ * Each augmentation is applied to an image with the augmentation
+ * probability. The augmentations drawn for an image are composed into a
+ * single axis-aligned affine map, so the image is resampled once and its
+ * boxes are mapped with the same transform. Pixels from outside of the
+ * input are zero. Boxes are clipped to the image, and boxes whose clipped
+ * area is less than minBoxArea are dropped.
+ *
+ * @code
+ * DetectionAugmentation augmentation({"horizontal-flip",
+ *     "random-resized-crop (0.6)"}, 0.5, 416, 416, 3);
+ * augmentation.Apply(images, boxes);
+ * @endcode
+ */
+class DetectionAugmentation
+{
+ public:
+  //! Create an empty augmentation.
+  DetectionAugmentation() :
+      augmentationProbability(0.0),
+      width(0),
+      height(0),
+      depth(0),
+      minBoxArea(1.0)
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Parses the given augmentations.
+   *
+   * @param augmentations Augmentations in the order they are applied. Each
+   *     one must be supported, see Supports().
+   * @param augmentationProbability Probability of applying an augmentation
+   *     to an image.
+   * @param width Width of images.
+   * @param height Height of images.
+   * @param depth Number of channels of images.
+   * @param minBoxArea Minimum area of a box after it's clipped to the image.
+   */
+  DetectionAugmentation(const std::vector<std::string>& augmentations,
+                        const double augmentationProbability,
+                        const size_t width,
+                        const size_t height,
+                        const size_t depth,
+                        const double minBoxArea = 1.0) :
+      augmentationProbability(augmentationProbability),
+      width(width),
+      height(height),
+      depth(depth),
+      minBoxArea(minBoxArea)
+  {
+    for (size_t i = 0; i < augmentations.size(); i++)
+    {
+      const std::string augmentation = mlpack::util::ToLower(augmentations[i]);
+      const std::string name = AugmentationPipeline::Name(augmentation);
+      Operation operation;
+      operation.params = AugmentationPipeline::Params(augmentation);
+      if (name == "horizontal-flip")
+        operation.type = HorizontalFlip;
+      else if (name == "vertical-flip")
+        operation.type = VerticalFlip;
+      else if (name == "random-resized-crop")
+      {
+        operation.type = RandomResizedCrop;
+        const double minScale = Param(operation, 0, 0.5);
+        if (minScale <= 0.0 || minScale > 1.0)
+        {
+          mlpack::Log::Fatal << "Minimum scale of " << augmentation << " must "
+              << "be in (0, 1]." << std::endl;
+        }
+      }
+      else if (name == "scale-jitter")
+        operation.type = ScaleJitter;
+      else if (name == "translate")
+        operation.type = Translate;
+      else
+      {
+        mlpack::Log::Fatal << "Augmentation " << augmentation << " can't be "
+            << "applied to bounding boxes." << std::endl;
+      }
+
+      operations.push_back(operation);
+    }
+  }
+
+  /**
+   * Get whether an augmentation is supported.
+   *
+   * @param augmentation String containing the augmentation.
+   */
+  static bool Supports(const std::string& augmentation)
+  {
+    const std::string name = AugmentationPipeline::Name(
+        mlpack::util::ToLower(augmentation));
+    return name == "horizontal-flip" || name == "vertical-flip" ||
+        name == "random-resized-crop" || name == "scale-jitter" ||
+        name == "translate";
+  }
+
+  /**
+   * Augments images and their bounding boxes in parallel. Each image draws
+   * random numbers from its own generator, seeded with the seed and the
+   * stream of the image.
+   *
+   * @param images Images that will be augmented in place, one per column.
+   * @param labels Bounding boxes of each image, either a field of vectors or
+   *     a matrix with one column per image. Boxes that are dropped are
+   *     removed from a field, and are set to -1 in a matrix.
+   * @param seed Seed shared by all images.
+   * @param streams Stream of each image. If empty, the stream of an image is
+   *     its column.
+   * @param numThreads Number of threads used. If 0, all threads available to
+   *     OpenMP are used.
+   */
+  template<typename MatType, typename LabelsType>
+  void Apply(MatType& images,
+             LabelsType& labels,
+             const size_t seed,
+             const arma::uvec& streams = arma::uvec(),
+             const size_t numThreads = 0) const
+  {
+    typedef typename MatType::elem_type ElemType;
+    typedef BilinearResize::AccumulatorType<ElemType> AccType;
+
+    if (operations.empty() || images.n_cols == 0)
+      return;
+
+    mlpack::Log::Assert(images.n_rows == width * height * depth,
+        "Shape of images doesn't match the number of rows.");
+    mlpack::Log::Assert(labels.n_cols == images.n_cols,
+        "Number of labels doesn't match the number of images.");
+    mlpack::Log::Assert(streams.n_elem == 0 || streams.n_elem == images.n_cols,
+        "Number of streams doesn't match the number of images.");
+
+    #pragma omp parallel num_threads(Utils::NumThreads(numThreads))
+    {
+      std::vector<ElemType> buffer(images.n_rows);
+      std::vector<AccType> row(width * depth);
+      std::vector<long> xOrigin(width), yOrigin(height);
+      std::vector<AccType> xWeight(width), yWeight(height);
+
+      #pragma omp for schedule(static)
+      for (omp_size_t col = 0; col < (omp_size_t) images.n_cols; col++)
+      {
+        const uint64_t stream = streams.n_elem > 0 ? streams(col) : col;
+        std::seed_seq sequence{(uint32_t) seed, (uint32_t) ((uint64_t) seed >>
+            32), (uint32_t) stream, (uint32_t) (stream >> 32)};
+        std::mt19937 generator(sequence);
+
+        const Transform transform = Draw(generator);
+        if (transform.Identity())
+          continue;
+
+        Warp(images.colptr(col), transform, buffer.data(), row.data(),
+            xOrigin, yOrigin, xWeight, yWeight);
+        TransformBoxes(labels, col, transform);
+      }
+    }
+  }
+
+  /**
+   * Augments images and their bounding boxes in parallel, using a random
+   * seed.
+   *
+   * @param images Images that will be augmented in place, one per column.
+   * @param labels Bounding boxes of each image.
+   */
+  template<typename MatType, typename LabelsType>
+  void Apply(MatType& images, LabelsType& labels) const
+  {
+    Apply(images, labels, mlpack::math::RandInt(1 << 30));
+  }
+
+  //! Get whether no augmentation is applied.
+  bool Empty() const { return operations.empty(); }
+
+ private:
+  //! Types of augmentations.
+  enum OperationType
+  {
+    HorizontalFlip,
+    VerticalFlip,
+    RandomResizedCrop,
+    ScaleJitter,
+    Translate
+  };
+
+  //! An augmentation and its parameters.
+  struct Operation
+  {
+    OperationType type;
+    std::vector<double> params;
+  };
+
+  //! Maps position (x, y) of the input to (scaleX * x + shiftX,
+  //! scaleY * y + shiftY) of the output.
+  struct Transform
+  {
+    double scaleX, scaleY, shiftX, shiftY;
+
+    //! Applies another transform after this one.
+    void Then(const double tScaleX,
+              const double tScaleY,
+              const double tShiftX,
+              const double tShiftY)
+    {
+      scaleX *= tScaleX;
+      scaleY *= tScaleY;
+      shiftX = tScaleX * shiftX + tShiftX;
+      shiftY = tScaleY * shiftY + tShiftY;
+    }
+
+    //! Get whether the transform doesn't move any pixel.
+    bool Identity() const
+    {
+      return scaleX == 1.0 && scaleY == 1.0 && shiftX == 0.0 && shiftY == 0.0;
+    }
+  };
+
+  //! Get the i-th parameter of an operation, or a default value.
+  static double Param(const Operation& operation,
+                      const size_t i,
+                      const double value)
+  {
+    return operation.params.size() > i ? operation.params[i] : value;
+  }
+
+  //! Draws the augmentations of an image and composes them.
+  Transform Draw(std::mt19937& generator) const
+  {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    Transform transform = {1.0, 1.0, 0.0, 0.0};
+    for (size_t i = 0; i < operations.size(); i++)
+    {
+      if (uniform(generator) >= augmentationProbability)
+        continue;
+
+      const Operation& operation = operations[i];
+      if (operation.type == HorizontalFlip)
+      {
+        transform.Then(-1.0, 1.0, width, 0.0);
+      }
+      else if (operation.type == VerticalFlip)
+      {
+        transform.Then(1.0, -1.0, 0.0, height);
+      }
+      else if (operation.type == RandomResizedCrop)
+      {
+        // The window keeps the aspect ratio of the image.
+        const double minScale = Param(operation, 0, 0.5);
+        const double scale = minScale + (1.0 - minScale) * uniform(generator);
+        const double x = (1.0 - scale) * width * uniform(generator);
+        const double y = (1.0 - scale) * height * uniform(generator);
+        transform.Then(1.0 / scale, 1.0 / scale, -x / scale, -y / scale);
+      }
+      else if (operation.type == ScaleJitter)
+      {
+        const double minScale = Param(operation, 0, 0.75);
+        const double maxScale = Param(operation, 1, 1.25);
+        const double scale = minScale + (maxScale - minScale) *
+            uniform(generator);
+        transform.Then(scale, scale, (1.0 - scale) * width / 2.0,
+            (1.0 - scale) * height / 2.0);
+      }
+      else
+      {
+        const double fraction = Param(operation, 0, 0.1);
+        transform.Then(1.0, 1.0, (2 * uniform(generator) - 1) * fraction *
+            width, (2 * uniform(generator) - 1) * fraction * height);
+      }
+    }
+
+    return transform;
+  }
+
+  /**
+   * Computes the input pixels sampled along one axis. The center of output
+   * pixel i is at i + 0.5, so it's sampled at (i + 0.5 - shift) / scale -
+   * 0.5 in pixels of the input.
+   */
+  template<typename AccType>
+  static void Table(const size_t size,
+                    const double scale,
+                    const double shift,
+                    std::vector<long>& origin,
+                    std::vector<AccType>& weight)
+  {
+    for (size_t i = 0; i < size; i++)
+    {
+      const double position = (i + 0.5 - shift) / scale - 0.5;
+      origin[i] = (long) std::floor(position);
+      weight[i] = (AccType) (position - origin[i]);
+    }
+  }
+
+  /**
+   * Resamples an image with the given transform in a single pass. Input
+   * rows are blended into a row buffer, then neighbouring pixels of the
+   * buffer are blended, like BilinearResize. Pixels outside of the input are
+   * zero.
+   */
+  template<typename ElemType, typename AccType>
+  void Warp(ElemType* image,
+            const Transform& transform,
+            ElemType* buffer,
+            AccType* row,
+            std::vector<long>& xOrigin,
+            std::vector<long>& yOrigin,
+            std::vector<AccType>& xWeight,
+            std::vector<AccType>& yWeight) const
+  {
+    Table(width, transform.scaleX, transform.shiftX, xOrigin, xWeight);
+    Table(height, transform.scaleY, transform.shiftY, yOrigin, yWeight);
+
+    const size_t rowSize = width * depth;
+    for (size_t y = 0; y < height; y++)
+    {
+      // Blend the two input rows, rows outside of the image are zero.
+      const long y0 = yOrigin[y];
+      const AccType wy = yWeight[y];
+      const AccType w0 = (y0 >= 0 && y0 < (long) height) ? 1 - wy : 0;
+      const AccType w1 = (y0 + 1 >= 0 && y0 + 1 < (long) height) ? wy : 0;
+      const ElemType* row0 = image + std::min(std::max(y0, 0L),
+          (long) height - 1) * rowSize;
+      const ElemType* row1 = image + std::min(std::max(y0 + 1, 0L),
+          (long) height - 1) * rowSize;
+      #pragma omp simd
+      for (size_t i = 0; i < rowSize; i++)
+        row[i] = w0 * row0[i] + w1 * row1[i];
+
+      // Blend neighbouring pixels of the row.
+      ElemType* outRow = buffer + y * rowSize;
+      for (size_t x = 0; x < width; x++)
+      {
+        const long x0 = xOrigin[x];
+        const AccType wx = xWeight[x];
+        const AccType v0 = (x0 >= 0 && x0 < (long) width) ? 1 - wx : 0;
+        const AccType v1 = (x0 + 1 >= 0 && x0 + 1 < (long) width) ? wx : 0;
+        const AccType* pixel0 = row + std::min(std::max(x0, 0L),
+            (long) width - 1) * depth;
+        const AccType* pixel1 = row + std::min(std::max(x0 + 1, 0L),
+            (long) width - 1) * depth;
+        ElemType* pixel = outRow + x * depth;
+        for (size_t c = 0; c < depth; c++)
+        {
+          pixel[c] = BilinearResize::Cast<ElemType>(v0 * pixel0[c] +
+              v1 * pixel1[c]);
+        }
+      }
+    }
+
+    std::copy(buffer, buffer + height * rowSize, image);
+  }
+
+  /**
+   * Maps boxes with the transform, clips them to the image and returns the
+   * number of boxes that are kept. Kept boxes are moved to the front.
+   */
+  size_t TransformBoxes(double* boxes,
+                        const size_t count,
+                        const Transform& transform) const
+  {
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+      const double* box = boxes + 5 * i;
+      double x1 = transform.scaleX * box[1] + transform.shiftX;
+      double x2 = transform.scaleX * box[3] + transform.shiftX;
+      double y1 = transform.scaleY * box[2] + transform.shiftY;
+      double y2 = transform.scaleY * box[4] + transform.shiftY;
+      if (x1 > x2)
+        std::swap(x1, x2);
+      if (y1 > y2)
+        std::swap(y1, y2);
+
+      x1 = std::min(std::max(x1, 0.0), (double) width);
+      x2 = std::min(std::max(x2, 0.0), (double) width);
+      y1 = std::min(std::max(y1, 0.0), (double) height);
+      y2 = std::min(std::max(y2, 0.0), (double) height);
+      if (x2 <= x1 || y2 <= y1 || (x2 - x1) * (y2 - y1) < minBoxArea)
+        continue;
+
+      double* keptBox = boxes + 5 * kept++;
+      keptBox[0] = box[0];
+      keptBox[1] = x1;
+      keptBox[2] = y1;
+      keptBox[3] = x2;
+      keptBox[4] = y2;
+    }
+
+    return kept;
+  }
+
+  //! Transforms boxes of an image stored in a field. Dropped boxes are
+  //! removed.
+  void TransformBoxes(arma::field<arma::vec>& labels,
+                      const size_t col,
+                      const Transform& transform) const
+  {
+    arma::vec& boxes = labels(0, col);
+    const size_t kept = TransformBoxes(boxes.memptr(), boxes.n_elem / 5,
+        transform);
+    boxes.resize(5 * kept);
+  }
+
+  //! Transforms boxes of an image stored in a column of a matrix. Dropped
+  //! boxes are set to -1, so every column keeps its size.
+  template<typename LabelsType>
+  void TransformBoxes(LabelsType& labels,
+                      const size_t col,
+                      const Transform& transform) const
+  {
+    arma::vec boxes = arma::conv_to<arma::vec>::from(labels.col(col));
+    const size_t kept = TransformBoxes(boxes.memptr(), boxes.n_elem / 5,
+        transform);
+    if (5 * kept < boxes.n_elem)
+      boxes.subvec(5 * kept, boxes.n_elem - 1).fill(-1);
+
+    labels.col(col) = arma::conv_to<arma::Col<typename
+        LabelsType::elem_type>>::from(boxes);
+  }
+
+  //! Locally stored probability of applying an augmentation.
+  double augmentationProbability;
+
+  //! Locally stored size of images.
+  size_t width, height, depth;
+
+  //! Locally stored minimum area of a box.
+  double minBoxArea;
+
+  //! Locally stored augmentations.
+  std::vector<Operation> operations;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
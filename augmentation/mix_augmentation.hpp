@@ -0,0 +1,345 @@
+/**
+ * @file mix_augmentation.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of MixAugmentation class that mixes pairs of images of a batch
+ * and their labels.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_AUGMENTATION_MIX_AUGMENTATION_HPP
+#define MODELS_AUGMENTATION_MIX_AUGMENTATION_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/util/to_lower.hpp>
+#include <augmentation/augmentation_pipeline.hpp>
+#include <augmentation/bilinear_resize.hpp>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Batch-level augmentations of classification datasets that mix pairs of
+ * images and their labels. Supported augmentations are:
+ *
+ *  - "mixup (alpha)": blends both images of a pair with a weight drawn from
+ *    Beta(alpha, alpha), alpha defaults to 0.2.
+ *  - "cutmix (alpha)": swaps a random rectangle between both images of a
+ *    pair. The area of the rectangle is drawn from Beta(alpha, alpha), alpha
+ *    defaults to 1.
+ *
+ * Images of a batch are paired at random and each pair is mixed with the
+ * augmentation probability. If both augmentations are given, each pair is
+ * mixed with one of them. Both images of a pair are mixed at once, so
+ * images are augmented in place without copying the batch. Labels are mixed
+ * with the same weights as the pixels, producing soft labels with one row per
+ * class, as expected by output layers such as ann::CrossEntropyError.
+ *
+ * @code
+ * MixAugmentation mix({"mixup (0.2)", "cutmix (1.0)"}, 1.0, 32, 32, 3, 10);
+ * arma::mat features, labels, targets;
+ * dataloader.TrainBatch(indices, features, labels);
+ * mix.Apply(features, labels, targets, seed);
+ * @endcode
+ */
+class MixAugmentation
+{
+ public:
+  //! Create an empty augmentation.
+  MixAugmentation() :
+      augmentationProbability(0.0),
+      width(0),
+      height(0),
+      depth(0),
+      numClasses(0),
+      mixUp(false),
+      cutMix(false),
+      mixUpAlpha(0.2),
+      cutMixAlpha(1.0)
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Parses the given augmentations.
+   *
+   * @param augmentations Augmentations that mix images, see Supports().
+   * @param augmentationProbability Probability of mixing a pair of images.
+   * @param width Width of images.
+   * @param height Height of images.
+   * @param depth Number of channels of images.
+   * @param numClasses Number of classes i.e. rows of soft labels.
+   */
+  MixAugmentation(const std::vector<std::string>& augmentations,
+                  const double augmentationProbability,
+                  const size_t width,
+                  const size_t height,
+                  const size_t depth,
+                  const size_t numClasses) :
+      augmentationProbability(augmentationProbability),
+      width(width),
+      height(height),
+      depth(depth),
+      numClasses(numClasses),
+      mixUp(false),
+      cutMix(false),
+      mixUpAlpha(0.2),
+      cutMixAlpha(1.0)
+  {
+    for (size_t i = 0; i < augmentations.size(); i++)
+    {
+      const std::string augmentation = mlpack::util::ToLower(augmentations[i]);
+      const std::string name = AugmentationPipeline::Name(augmentation);
+      const std::vector<double> params = AugmentationPipeline::Params(
+          augmentation);
+      if (name == "mixup")
+      {
+        mixUp = true;
+        mixUpAlpha = params.empty() ? 0.2 : params[0];
+      }
+      else if (name == "cutmix")
+      {
+        cutMix = true;
+        cutMixAlpha = params.empty() ? 1.0 : params[0];
+      }
+      else
+      {
+        mlpack::Log::Fatal << "Augmentation " << augmentation << " doesn't "
+            << "mix images." << std::endl;
+      }
+    }
+
+    if ((mixUp && mixUpAlpha <= 0) || (cutMix && cutMixAlpha <= 0))
+      mlpack::Log::Fatal << "Alpha of mixing must be positive." << std::endl;
+  }
+
+  /**
+   * Get whether an augmentation is supported.
+   *
+   * @param augmentation String containing the augmentation.
+   */
+  static bool Supports(const std::string& augmentation)
+  {
+    const std::string name = AugmentationPipeline::Name(
+        mlpack::util::ToLower(augmentation));
+    return name == "mixup" || name == "cutmix";
+  }
+
+  /**
+   * Mixes pairs of images of a batch in place and computes their soft
+   * labels. Pairs, weights and rectangles are drawn from a generator seeded
+   * with seed, so the result doesn't depend on the number of threads.
+   *
+   * @param features Images of the batch, one per column. They are mixed in
+   *     place.
+   * @param labels Labels of the batch, either a row of class indices starting
+   *     at 0, or one row per class holding the probability of each class.
+   * @param targets Matrix where soft labels with one row per class are
+   *     stored. Its memory is reused if it already has the right shape. It
+   *     may be the same matrix as labels if labels are soft.
+   * @param seed Seed of the batch.
+   */
+  template<typename MatType, typename LabelsType, typename TargetsType>
+  void Apply(MatType& features,
+             const LabelsType& labels,
+             TargetsType& targets,
+             const size_t seed) const
+  {
+    typedef typename MatType::elem_type ElemType;
+    typedef BilinearResize::AccumulatorType<ElemType> AccType;
+
+    mlpack::Log::Assert(features.n_cols == 0 ||
+        features.n_rows == width * height * depth,
+        "Shape of images doesn't match the number of rows.");
+    mlpack::Log::Assert(labels.n_cols == features.n_cols,
+        "Number of labels doesn't match the number of images.");
+
+    // Soft labels of the batch before mixing.
+    const size_t n = features.n_cols;
+    if (labels.n_rows == numClasses && numClasses > 1)
+    {
+      if ((const void*) &targets != (const void*) &labels)
+        targets = labels;
+    }
+    else
+    {
+      targets.zeros(numClasses, n);
+      for (size_t i = 0; i < n; i++)
+      {
+        const size_t label = (size_t) labels(0, i);
+        mlpack::Log::Assert(label < numClasses, "Label is not a class.");
+        targets(label, i) = 1;
+      }
+    }
+
+    if (Empty() || n < 2)
+      return;
+
+    // Draw everything serially, so that pairs can be mixed in parallel.
+    std::mt19937 generator(seed);
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; i++)
+      order[i] = i;
+    std::shuffle(order.begin(), order.end(), generator);
+
+    std::vector<Pair> pairs(n / 2);
+    std::uniform_real_distribution<double> probability(0.0, 1.0);
+    for (size_t p = 0; p < pairs.size(); p++)
+    {
+      Pair& pair = pairs[p];
+      pair.first = order[2 * p];
+      pair.second = order[2 * p + 1];
+      if (probability(generator) >= augmentationProbability)
+        continue;
+
+      pair.cutMix = cutMix && (!mixUp || probability(generator) < 0.5);
+      if (!pair.cutMix)
+      {
+        pair.weight = Beta(mixUpAlpha, generator);
+        continue;
+      }
+
+      // A rectangle with area (1 - lambda) times the area of the image,
+      // centered anywhere in the image and clipped to it.
+      const double ratio = std::sqrt(1 - Beta(cutMixAlpha, generator));
+      const long cutWidth = (long) std::round(width * ratio);
+      const long cutHeight = (long) std::round(height * ratio);
+      const long centerX = std::uniform_int_distribution<long>(0,
+          (long) width - 1)(generator);
+      const long centerY = std::uniform_int_distribution<long>(0,
+          (long) height - 1)(generator);
+      pair.x1 = (size_t) std::max(0L, centerX - cutWidth / 2);
+      pair.y1 = (size_t) std::max(0L, centerY - cutHeight / 2);
+      pair.x2 = (size_t) std::min((long) width, centerX - cutWidth / 2 +
+          cutWidth);
+      pair.y2 = (size_t) std::min((long) height, centerY - cutHeight / 2 +
+          cutHeight);
+      pair.weight = 1 - (double) (pair.x2 - pair.x1) * (pair.y2 - pair.y1) /
+          (width * height);
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (omp_size_t p = 0; p < (omp_size_t) pairs.size(); p++)
+    {
+      const Pair& pair = pairs[p];
+      if (pair.weight == 1.0)
+        continue;
+
+      ElemType* first = features.colptr(pair.first);
+      ElemType* second = features.colptr(pair.second);
+      if (pair.cutMix)
+      {
+        const size_t rowSize = width * depth;
+        for (size_t y = pair.y1; y < pair.y2; y++)
+        {
+          std::swap_ranges(first + y * rowSize + pair.x1 * depth,
+              first + y * rowSize + pair.x2 * depth,
+              second + y * rowSize + pair.x1 * depth);
+        }
+      }
+      else
+      {
+        const AccType weight = (AccType) pair.weight;
+        #pragma omp simd
+        for (size_t i = 0; i < features.n_rows; i++)
+        {
+          const AccType a = first[i], b = second[i];
+          first[i] = BilinearResize::Cast<ElemType>(b + weight * (a - b));
+          second[i] = BilinearResize::Cast<ElemType>(a + weight * (b - a));
+        }
+      }
+
+      for (size_t c = 0; c < numClasses; c++)
+      {
+        const double a = targets(c, pair.first), b = targets(c, pair.second);
+        targets(c, pair.first) = pair.weight * a + (1 - pair.weight) * b;
+        targets(c, pair.second) = pair.weight * b + (1 - pair.weight) * a;
+      }
+    }
+  }
+
+  /**
+   * Mixes pairs of images of a batch in place and computes their soft
+   * labels, using a random seed.
+   *
+   * @param features Images of the batch, one per column.
+   * @param labels Labels of the batch.
+   * @param targets Matrix where soft labels are stored.
+   */
+  template<typename MatType, typename LabelsType, typename TargetsType>
+  void Apply(MatType& features,
+             const LabelsType& labels,
+             TargetsType& targets) const
+  {
+    Apply(features, labels, targets, mlpack::math::RandInt(1 << 30));
+  }
+
+  //! Get whether no augmentation is applied.
+  bool Empty() const { return !mixUp && !cutMix; }
+
+  //! Get the number of classes.
+  size_t NumClasses() const { return numClasses; }
+
+ private:
+  //! Two images mixed with each other.
+  struct Pair
+  {
+    //! Create a pair that isn't mixed.
+    Pair() :
+        first(0),
+        second(0),
+        cutMix(false),
+        weight(1.0),
+        x1(0),
+        y1(0),
+        x2(0),
+        y2(0)
+    {
+      // Nothing to do here.
+    }
+
+    //! Columns of both images.
+    size_t first, second;
+
+    //! Whether a rectangle is swapped instead of blending the images.
+    bool cutMix;
+
+    //! Weight of each image in its own mixed image and label.
+    double weight;
+
+    //! CutMix: corners of the swapped rectangle, excluding x2 and y2.
+    size_t x1, y1, x2, y2;
+  };
+
+  //! Draws a number from Beta(alpha, alpha).
+  static double Beta(const double alpha, std::mt19937& generator)
+  {
+    std::gamma_distribution<double> gamma(alpha, 1.0);
+    const double x = gamma(generator);
+    const double y = gamma(generator);
+    return (x + y > 0) ? x / (x + y) : 0.5;
+  }
+
+  //! Locally stored probability of mixing a pair of images.
+  double augmentationProbability;
+
+  //! Locally stored size of images.
+  size_t width, height, depth;
+
+  //! Locally stored number of classes.
+  size_t numClasses;
+
+  //! Locally stored whether MixUp and CutMix are applied.
+  bool mixUp, cutMix;
+
+  //! Locally stored parameters of Beta distributions.
+  double mixUpAlpha, cutMixAlpha;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
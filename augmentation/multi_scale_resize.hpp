@@ -0,0 +1,266 @@
+/**
+ * @file multi_scale_resize.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of MultiScaleResize class that resizes batches of an object
+ * detection dataset to a resolution that changes during training.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_AUGMENTATION_MULTI_SCALE_RESIZE_HPP
+#define MODELS_AUGMENTATION_MULTI_SCALE_RESIZE_HPP
+
+#include <mlpack/core.hpp>
+#include <augmentation/bilinear_resize.hpp>
+#include <utils/utils.hpp>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Multi-scale training of object detection models. Every period batches a
+ * new resolution is drawn from a set of resolutions, and batches are resized
+ * to it. Each image and its bounding boxes are resized in the same pass.
+ * Bounding boxes are stored as class, x1, y1, x2, y2 in pixels of the image,
+ * as loaded by DataLoader::LoadObjectDetectionDataset().
+ *
+ * The resolution of a batch only depends on the seed and the index of the
+ * batch, so training is reproducible.
+ *
+ * @code
+ * // Batches of 416 x 416 images are resized to 320 x 320 up to 608 x 608,
+ * // changing every 10 batches. The model is created for the smallest
+ * // resolution, see YOLO::SetInputResolution().
+ * YOLO<> yolo(3, 320, 320);
+ * MultiScaleResize multiScale({320, 352, 384, 416, 448, 480, 512, 544, 576,
+ *     608}, 10, 416, 416, 3);
+ * for (size_t batch = 0; batch < batches; batch++)
+ * {
+ *   dataloader.TrainBatch(batch * batchSize, batchSize, images, boxes);
+ *   multiScale.Apply(images, boxes, batch);
+ *   yolo.SetInputResolution(multiScale.Width(batch), multiScale.Height(batch));
+ *   PreProcessor<arma::mat, arma::field<arma::vec>>::YOLOPreProcessor(boxes,
+ *       targets, 1, multiScale.Width(batch), multiScale.Height(batch));
+ *   yolo.GetModel().Train(images, targets, optimizer);
+ * }
+ * @endcode
+ */
+class MultiScaleResize
+{
+ public:
+  //! Create an empty multi-scale resize.
+  MultiScaleResize() :
+      period(1),
+      width(0),
+      height(0),
+      depth(0),
+      seed(0)
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Create a multi-scale resize with square resolutions.
+   *
+   * @param sizes Width and height of each resolution.
+   * @param period Number of batches between changes of the resolution.
+   * @param width Width of images of batches.
+   * @param height Height of images of batches.
+   * @param depth Number of channels of images.
+   * @param seed Seed used to draw resolutions.
+   */
+  MultiScaleResize(const std::vector<size_t>& sizes,
+                   const size_t period,
+                   const size_t width,
+                   const size_t height,
+                   const size_t depth,
+                   const size_t seed = 0) :
+      period(std::max<size_t>(period, 1)),
+      width(width),
+      height(height),
+      depth(depth),
+      seed(seed)
+  {
+    for (size_t i = 0; i < sizes.size(); i++)
+      resolutions.push_back(std::make_pair(sizes[i], sizes[i]));
+
+    if (resolutions.empty())
+    {
+      mlpack::Log::Fatal << "No resolution given for multi-scale training."
+          << std::endl;
+    }
+  }
+
+  /**
+   * Create a multi-scale resize.
+   *
+   * @param resolutions Width and height of each resolution.
+   * @param period Number of batches between changes of the resolution.
+   * @param width Width of images of batches.
+   * @param height Height of images of batches.
+   * @param depth Number of channels of images.
+   * @param seed Seed used to draw resolutions.
+   */
+  MultiScaleResize(
+      const std::vector<std::pair<size_t, size_t>>& resolutions,
+      const size_t period,
+      const size_t width,
+      const size_t height,
+      const size_t depth,
+      const size_t seed = 0) :
+      resolutions(resolutions),
+      period(std::max<size_t>(period, 1)),
+      width(width),
+      height(height),
+      depth(depth),
+      seed(seed)
+  {
+    if (this->resolutions.empty())
+    {
+      mlpack::Log::Fatal << "No resolution given for multi-scale training."
+          << std::endl;
+    }
+  }
+
+  /**
+   * Resizes a batch and its bounding boxes to the resolution of the batch.
+   * Images are resized in parallel, and the boxes of an image are scaled
+   * right after the image.
+   *
+   * @param images Images of the batch, one per column. They are replaced by
+   *     the resized images.
+   * @param labels Bounding boxes of each image, either a field of vectors or
+   *     a matrix with one column per image. Boxes whose class is negative
+   *     are padding and aren't scaled.
+   * @param batch Index of the batch.
+   * @param numThreads Number of threads used to resize images, 0 to use all
+   *     available threads.
+   */
+  template<typename MatType, typename LabelsType>
+  void Apply(MatType& images,
+             LabelsType& labels,
+             const size_t batch,
+             const size_t numThreads = 0) const
+  {
+    typedef typename MatType::elem_type ElemType;
+
+    mlpack::Log::Assert(images.n_rows == width * height * depth,
+        "Shape of images doesn't match the number of rows.");
+    mlpack::Log::Assert(labels.n_cols == images.n_cols,
+        "Number of labels doesn't match the number of images.");
+
+    const std::pair<size_t, size_t>& resolution = Resolution(batch);
+    if (resolution.first == width && resolution.second == height)
+      return;
+
+    const BilinearResize resize(width, height, resolution.first,
+        resolution.second, depth);
+    MatType output;
+    output.set_size(resolution.first * resolution.second * depth,
+        images.n_cols);
+
+    #pragma omp parallel num_threads(Utils::NumThreads(numThreads))
+    {
+      std::vector<BilinearResize::AccumulatorType<ElemType>> row(
+          resize.RowSize());
+
+      #pragma omp for schedule(static)
+      for (omp_size_t col = 0; col < (omp_size_t) images.n_cols; col++)
+      {
+        resize.Resize(images.colptr(col), output.colptr(col), row.data());
+        ScaleBoxes(labels, col, resize.ScaleX(), resize.ScaleY());
+      }
+    }
+
+    images = std::move(output);
+  }
+
+  //! Get the resolution of a batch as its width and height.
+  const std::pair<size_t, size_t>& Resolution(const size_t batch) const
+  {
+    const uint64_t step = batch / period;
+    std::seed_seq sequence{(uint32_t) seed, (uint32_t) ((uint64_t) seed >>
+        32), (uint32_t) step, (uint32_t) (step >> 32)};
+    std::mt19937 generator(sequence);
+    return resolutions[std::uniform_int_distribution<size_t>(0,
+        resolutions.size() - 1)(generator)];
+  }
+
+  //! Get the width of images of a batch after it's resized.
+  size_t Width(const size_t batch) const { return Resolution(batch).first; }
+
+  //! Get the height of images of a batch after it's resized.
+  size_t Height(const size_t batch) const { return Resolution(batch).second; }
+
+  //! Get the resolutions batches are resized to.
+  const std::vector<std::pair<size_t, size_t>>& Resolutions() const
+  {
+    return resolutions;
+  }
+
+  //! Get the number of batches between changes of the resolution.
+  size_t Period() const { return period; }
+
+ private:
+  //! Scales boxes of an image stored in a field.
+  static void ScaleBoxes(arma::field<arma::vec>& labels,
+                         const size_t col,
+                         const double scaleX,
+                         const double scaleY)
+  {
+    arma::vec& boxes = labels(0, col);
+    ScaleBoxes(boxes.memptr(), boxes.n_elem / 5, scaleX, scaleY);
+  }
+
+  //! Scales boxes of an image stored in a column of a matrix.
+  template<typename LabelsType>
+  static void ScaleBoxes(LabelsType& labels,
+                         const size_t col,
+                         const double scaleX,
+                         const double scaleY)
+  {
+    arma::vec boxes = arma::conv_to<arma::vec>::from(labels.col(col));
+    ScaleBoxes(boxes.memptr(), boxes.n_elem / 5, scaleX, scaleY);
+    labels.col(col) = arma::conv_to<arma::Col<typename
+        LabelsType::elem_type>>::from(boxes);
+  }
+
+  //! Scales count boxes stored one after another.
+  static void ScaleBoxes(double* boxes,
+                         const size_t count,
+                         const double scaleX,
+                         const double scaleY)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      double* box = boxes + 5 * i;
+      if (box[0] < 0)
+        continue;
+
+      box[1] *= scaleX;
+      box[2] *= scaleY;
+      box[3] *= scaleX;
+      box[4] *= scaleY;
+    }
+  }
+
+  //! Locally stored width and height of each resolution.
+  std::vector<std::pair<size_t, size_t>> resolutions;
+
+  //! Locally stored number of batches between changes of the resolution.
+  size_t period;
+
+  //! Locally stored size of images of batches.
+  size_t width, height, depth;
+
+  //! Locally stored seed used to draw resolutions.
+  size_t seed;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
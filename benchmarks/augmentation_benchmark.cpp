@@ -0,0 +1,287 @@
+/**
+ * @file augmentation_benchmark.cpp
+ * @author Kartik Dutt
+ *
+ * Throughput of augmentations and preprocessing of images on synthetic data.
+ * Each operation is run for every combination of image size, batch size and
+ * number of threads, and the results are printed as JSON:
+ *
+ * @code
+ * {"build": {"type": "Release", "optimized": true, "arma_debug": false},
+ *  "benchmarks": [
+ *   {"op": "ResizeTransform", "width": 224, "height": 224, "depth": 3,
+ *    "batch": 64, "threads": 8, "iterations": 40, "seconds": 0.0021,
+ *    "images_per_second": 30476.2, "bytes_per_second": 3.67e+10},
+ *   ...
+ * ]}
+ * @endcode
+ *
+ * Usage:
+ *
+ *   models_benchmark [--sizes 64,224,416] [--batches 16,64] [--threads 1,8]
+ *       [--min-time 0.5] [--output results.json]
+ *
+ * Seconds are the mean time of one call, and bytes are the bytes of the
+ * input of a call: images, or bounding boxes for YOLOPreProcessor. The
+ * benchmark is compiled with optimizations and without Armadillo's debug
+ * checks regardless of the build type, and warns if it isn't.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#include <augmentation/augmentation.hpp>
+#include <dataloader/preprocessor.hpp>
+#include <utils/utils.hpp>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <sstream>
+
+using namespace mlpack::models;
+
+#ifndef MODELS_BENCHMARK_BUILD_TYPE
+  #define MODELS_BENCHMARK_BUILD_TYPE ""
+#endif
+
+//! Whether the benchmark was compiled with optimizations. MSVC doesn't say,
+//! so release builds are assumed to be optimized.
+#if defined(__OPTIMIZE__) || (defined(_MSC_VER) && defined(NDEBUG))
+  const bool optimized = true;
+#else
+  const bool optimized = false;
+#endif
+
+//! Whether Armadillo checks bounds and sizes.
+#ifdef ARMA_NO_DEBUG
+  const bool armaDebug = false;
+#else
+  const bool armaDebug = true;
+#endif
+
+//! An operation that is benchmarked, and the bytes of the input of a call.
+struct Operation
+{
+  std::string name;
+  std::function<void(arma::mat&)> function;
+  size_t bytes;
+};
+
+//! Result of benchmarking an operation for one configuration.
+struct Result
+{
+  std::string op;
+  size_t width, height, depth, batch, threads, iterations, bytes;
+  double seconds;
+};
+
+/**
+ * Runs an operation until at least minTime seconds were spent in it. The
+ * operation gets a fresh copy of the input on every call, which isn't timed.
+ *
+ * @param input Images passed to the operation.
+ * @param operation Operation that is benchmarked.
+ * @param minTime Minimum time spent in the operation.
+ * @param iterations Number of calls of the operation.
+ * @return Mean time of a call in seconds.
+ */
+double Time(const arma::mat& input,
+            const std::function<void(arma::mat&)>& operation,
+            const double minTime,
+            size_t& iterations)
+{
+  // Warm up caches and the thread pool.
+  arma::mat images = input;
+  operation(images);
+
+  double total = 0.0;
+  iterations = 0;
+  while (total < minTime || iterations < 3)
+  {
+    images = input;
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    operation(images);
+    total += std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    iterations++;
+  }
+
+  return total / iterations;
+}
+
+//! Parses a comma separated list of numbers.
+std::vector<size_t> ParseList(const std::string& list)
+{
+  std::vector<size_t> values;
+  std::stringstream stream(list);
+  std::string value;
+  while (std::getline(stream, value, ','))
+    values.push_back(std::stoul(value));
+
+  return values;
+}
+
+//! Writes results as JSON.
+void WriteJSON(std::ostream& stream, const std::vector<Result>& results)
+{
+  stream << "{\"build\": {\"type\": \"" << MODELS_BENCHMARK_BUILD_TYPE
+      << "\", \"optimized\": " << (optimized ? "true" : "false")
+      << ", \"arma_debug\": " << (armaDebug ? "true" : "false") << "},"
+      << std::endl << " \"benchmarks\": [" << std::endl;
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    const Result& r = results[i];
+    const double imagesPerSecond = r.batch / r.seconds;
+    const double bytesPerSecond = r.bytes / r.seconds;
+    stream << "  {\"op\": \"" << r.op << "\", \"width\": " << r.width
+        << ", \"height\": " << r.height << ", \"depth\": " << r.depth
+        << ", \"batch\": " << r.batch << ", \"threads\": " << r.threads
+        << ", \"iterations\": " << r.iterations << ", \"seconds\": "
+        << r.seconds << ", \"images_per_second\": " << imagesPerSecond
+        << ", \"bytes_per_second\": " << bytesPerSecond << "}"
+        << (i + 1 < results.size() ? "," : "") << std::endl;
+  }
+  stream << "]}" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  std::vector<size_t> sizes = {64, 224, 416};
+  std::vector<size_t> batches = {16, 64};
+  std::vector<size_t> threads = {1, (size_t) Utils::NumThreads()};
+  double minTime = 0.5;
+  std::string outputPath;
+
+  for (int i = 1; i < argc; i += 2)
+  {
+    const std::string option = argv[i];
+    if (i + 1 == argc)
+    {
+      mlpack::Log::Fatal << "Option " << option << " needs a value."
+          << std::endl;
+    }
+
+    if (option == "--sizes")
+      sizes = ParseList(argv[i + 1]);
+    else if (option == "--batches")
+      batches = ParseList(argv[i + 1]);
+    else if (option == "--threads")
+      threads = ParseList(argv[i + 1]);
+    else if (option == "--min-time")
+      minTime = std::stod(argv[i + 1]);
+    else if (option == "--output")
+      outputPath = argv[i + 1];
+    else
+      mlpack::Log::Fatal << "Unknown option " << option << "." << std::endl;
+  }
+
+  // Remove duplicates, e.g. when only one thread is available.
+  std::sort(threads.begin(), threads.end());
+  threads.erase(std::unique(threads.begin(), threads.end()), threads.end());
+
+  if (!optimized || armaDebug)
+  {
+    mlpack::Log::Warn << "The benchmark isn't optimized or checks bounds, "
+        << "results aren't representative." << std::endl;
+  }
+
+  const size_t depth = 3, boxesPerImage = 4;
+  std::vector<Result> results;
+  for (const size_t size : sizes)
+  {
+    for (const size_t batch : batches)
+    {
+      arma::mat input = arma::randi<arma::mat>(size * size * depth, batch,
+          arma::distr_param(0, 255));
+
+      // Boxes with class, x1, y1, x2, y2 inside the image, at most two per
+      // cell of the 7 x 7 grid.
+      arma::field<arma::vec> boxes(1, batch);
+      for (size_t i = 0; i < batch; i++)
+      {
+        boxes(0, i).set_size(5 * boxesPerImage);
+        for (size_t j = 0; j < boxesPerImage; j++)
+        {
+          const double x = (double) (size / 2) * j / boxesPerImage;
+          boxes(0, i).subvec(5 * j, 5 * j + 4) = arma::vec({(double) (j % 20),
+              x, x, x + size / 2.0, x + size / 2.0});
+        }
+      }
+
+      const size_t imageBytes = input.n_elem * sizeof(double);
+      const size_t boxBytes = batch * 5 * boxesPerImage * sizeof(double);
+
+      // Augmentations are created once, so that parsing them isn't timed.
+      Augmentation augmentation({"horizontal-flip", "rotate (10)",
+          "brightness (0.2)"}, 0.5);
+      const std::string resize = "resize (" + std::to_string(size / 2) +
+          ", " + std::to_string(size / 2) + ")";
+      Augmentation resizeAugmentation({resize}, 0.0);
+
+      std::vector<Operation> operations;
+      operations.push_back({"Transform",
+          [&augmentation, size](arma::mat& images)
+          {
+            augmentation.Transform(images, size, size, depth);
+          }, imageBytes});
+      operations.push_back({"ResizeTransform",
+          [&resizeAugmentation, &resize, size](arma::mat& images)
+          {
+            resizeAugmentation.ResizeTransform(images, size, size, depth,
+                resize);
+          }, imageBytes});
+      operations.push_back({"YOLOPreProcessor",
+          [&boxes, size](arma::mat& /* images */)
+          {
+            arma::mat targets;
+            PreProcessor<arma::mat, arma::field<arma::vec>>::YOLOPreProcessor(
+                boxes, targets, 1, size, size);
+          }, boxBytes});
+      operations.push_back({"ChannelFirstImages",
+          [size](arma::mat& images)
+          {
+            PreProcessor<>::ChannelFirstImages(images, size, size, depth);
+          }, imageBytes});
+
+      for (const size_t numThreads : threads)
+      {
+        #ifdef _OPENMP
+          omp_set_num_threads((int) numThreads);
+        #endif
+
+        for (size_t o = 0; o < operations.size(); o++)
+        {
+          Result result;
+          result.op = operations[o].name;
+          result.width = size;
+          result.height = size;
+          result.depth = depth;
+          result.batch = batch;
+          result.threads = numThreads;
+          result.bytes = operations[o].bytes;
+          result.seconds = Time(input, operations[o].function, minTime,
+              result.iterations);
+          results.push_back(result);
+
+          mlpack::Log::Info << result.op << " " << size << "x" << size
+              << ", batch " << batch << ", " << numThreads << " threads: "
+              << batch / result.seconds << " images/s." << std::endl;
+        }
+      }
+    }
+  }
+
+  if (outputPath.empty())
+  {
+    WriteJSON(std::cout, results);
+  }
+  else
+  {
+    std::ofstream output(outputPath);
+    WriteJSON(output, results);
+  }
+
+  return 0;
+}
@@ -0,0 +1,396 @@
+/**
+ * @file annotation_parser.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of AnnotationParser class for parsing XML annotations of object
+ * detection datasets.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_DATALOADER_ANNOTATION_PARSER_HPP
+#define MODELS_DATALOADER_ANNOTATION_PARSER_HPP
+
+#include <mlpack/prereqs.hpp>
+#include <unordered_map>
+#include <algorithm>
+#include <fstream>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Annotation of a single image.
+ */
+struct Annotation
+{
+  //! Filename of the image.
+  std::string imageName;
+
+  //! Width of the image.
+  size_t width;
+
+  //! Height of the image.
+  size_t height;
+
+  //! Depth / Number of channels of the image.
+  size_t depth;
+
+  //! Offset of the first object in the buffer of boxes the annotation was
+  //! parsed into. Each object is stored as class, x1, y1, x2, y2, in the
+  //! reverse order of the annotation file.
+  size_t boxOffset;
+
+  //! Number of objects in the image.
+  size_t numBoxes;
+};
+
+/**
+ * Streaming parser for PASCAL VOC style XML annotations. Tag names are mapped
+ * to ids once, so an annotation file is parsed in a single pass over its
+ * contents without building a tree. Boxes of many annotations are appended
+ * to one flat buffer, so no memory is allocated per annotation once the
+ * buffer has grown. Parse() is const, so files can be parsed by several
+ * threads at once, each with its own buffer.
+ *
+ * @code
+ * AnnotationParser parser({"cat", "dog"});
+ * Annotation annotation;
+ * std::vector<double> boxes;
+ * if (parser.Parse("path/to/annotation.xml", annotation, boxes))
+ *   std::cout << annotation.numBoxes << " objects." << std::endl;
+ * @endcode
+ */
+class AnnotationParser
+{
+ public:
+  /**
+   * Constructor for AnnotationParser. Tag names are the same as those passed
+   * to DataLoader::LoadObjectDetectionDataset().
+   *
+   * @param classes Names of classes. Objects of other classes are skipped.
+   * @param baseXMLTag XML tag name which wraps around the annotation file.
+   * @param imageNameXMLTag XML tag name which holds the image filename.
+   * @param sizeXMLTag XML tag name which holds the size of the image.
+   * @param objectXMLTag XML tag name which holds details of bounding box.
+   * @param bndboxXMLTag XML tag name which holds coordinates of bounding box.
+   * @param classNameXMLTag XML tag name inside objectXMLTag which holds the
+   *     name of the class of bounding box.
+   * @param x1XMLTag XML tag name which holds lower most x coordinate.
+   * @param y1XMLTag XML tag name which holds lower most y coordinate.
+   * @param x2XMLTag XML tag name which holds upper most x coordinate.
+   * @param y2XMLTag XML tag name which holds upper most y coordinate.
+   */
+  AnnotationParser(const std::vector<std::string>& classes,
+                   const std::string& baseXMLTag = "annotation",
+                   const std::string& imageNameXMLTag = "filename",
+                   const std::string& sizeXMLTag = "size",
+                   const std::string& objectXMLTag = "object",
+                   const std::string& bndboxXMLTag = "bndbox",
+                   const std::string& classNameXMLTag = "name",
+                   const std::string& x1XMLTag = "xmin",
+                   const std::string& y1XMLTag = "ymin",
+                   const std::string& x2XMLTag = "xmax",
+                   const std::string& y2XMLTag = "ymax")
+  {
+    for (size_t i = 0; i < classes.size(); i++)
+      classMap.insert(std::make_pair(classes[i], i));
+
+    // If tag names are repeated, the first one is used.
+    tags.push_back(std::make_pair(baseXMLTag, Base));
+    tags.push_back(std::make_pair(imageNameXMLTag, ImageName));
+    tags.push_back(std::make_pair(sizeXMLTag, Size));
+    tags.push_back(std::make_pair("width", Width));
+    tags.push_back(std::make_pair("height", Height));
+    tags.push_back(std::make_pair("depth", Depth));
+    tags.push_back(std::make_pair(objectXMLTag, Object));
+    tags.push_back(std::make_pair(bndboxXMLTag, BoundingBox));
+    tags.push_back(std::make_pair(classNameXMLTag, ClassName));
+    tags.push_back(std::make_pair(x1XMLTag, X1));
+    tags.push_back(std::make_pair(y1XMLTag, Y1));
+    tags.push_back(std::make_pair(x2XMLTag, X2));
+    tags.push_back(std::make_pair(y2XMLTag, Y2));
+  }
+
+  /**
+   * Parses an annotation file.
+   *
+   * @param path Path to the XML annotation file.
+   * @param annotation Annotation where the result will be stored.
+   * @param boxes Buffer the boxes of the annotation are appended to.
+   * @return true if the file contains an image name and size else false.
+   */
+  bool Parse(const std::string& path,
+             Annotation& annotation,
+             std::vector<double>& boxes) const
+  {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+      return false;
+
+    std::string contents(file.tellg(), '\0');
+    file.seekg(0);
+    file.read(&contents[0], contents.size());
+    return ParseString(contents, annotation, boxes);
+  }
+
+  /**
+   * Parses the contents of an annotation file.
+   *
+   * @param contents Contents of the XML annotation file.
+   * @param annotation Annotation where the result will be stored.
+   * @param boxes Buffer the boxes of the annotation are appended to. If the
+   *     contents aren't an annotation, the buffer is left unchanged.
+   * @return true if the contents hold an image name and size else false.
+   */
+  bool ParseString(const std::string& contents,
+                   Annotation& annotation,
+                   std::vector<double>& boxes) const
+  {
+    annotation.imageName.clear();
+    annotation.width = annotation.height = annotation.depth = 0;
+    annotation.boxOffset = boxes.size();
+    annotation.numBoxes = 0;
+
+    // Ids of open tags, the object being parsed and whether its class is
+    // known.
+    std::vector<Tag> stack;
+    double object[5] = {0, 0, 0, 0, 0};
+    bool knownClass = false;
+    bool hasName = false, hasSize = false;
+
+    const char* data = contents.data();
+    const char* end = data + contents.size();
+    const char* text = data;
+    for (const char* c = data; c < end; c++)
+    {
+      if (*c != '<')
+        continue;
+
+      // Skip declarations and comments.
+      if (c + 1 < end && (c[1] == '?' || c[1] == '!'))
+      {
+        const char* close = (c + 3 < end && c[2] == '-' && c[3] == '-') ?
+            Find(c + 4, end, "-->") : Find(c + 2, end, ">");
+        c = (close == end) ? end : close;
+        continue;
+      }
+
+      const bool closing = c + 1 < end && c[1] == '/';
+      const char* nameBegin = closing ? c + 2 : c + 1;
+      const char* nameEnd = nameBegin;
+      while (nameEnd < end && !std::isspace((unsigned char) *nameEnd) &&
+          *nameEnd != '>' && *nameEnd != '/')
+      {
+        nameEnd++;
+      }
+
+      const char* tagEnd = std::find(nameEnd, end, '>');
+      if (tagEnd == end)
+        break;
+
+      if (closing)
+      {
+        if (stack.empty())
+        {
+          boxes.resize(annotation.boxOffset);
+          return false;
+        }
+
+        const Tag tag = stack.back();
+        if (tag != Other)
+        {
+          HandleText(stack, text, c, annotation, object, knownClass, hasName,
+              hasSize);
+        }
+
+        if (tag == Object && stack.size() == 2 && knownClass)
+          boxes.insert(boxes.end(), object, object + 5);
+
+        stack.pop_back();
+      }
+      else if (tagEnd[-1] != '/')
+      {
+        stack.push_back(Lookup(nameBegin, nameEnd));
+        if (stack.back() == Object && stack.size() == 2)
+        {
+          std::fill(object, object + 5, 0.0);
+          knownClass = false;
+        }
+      }
+
+      c = tagEnd;
+      text = tagEnd + 1;
+    }
+
+    if (!hasName || !hasSize)
+    {
+      boxes.resize(annotation.boxOffset);
+      return false;
+    }
+
+    // Objects were appended in the order of the file, reverse them once.
+    annotation.numBoxes = (boxes.size() - annotation.boxOffset) / 5;
+    std::reverse(boxes.begin() + annotation.boxOffset, boxes.end());
+    for (size_t i = annotation.boxOffset; i < boxes.size(); i += 5)
+      std::reverse(boxes.begin() + i, boxes.begin() + i + 5);
+
+    return true;
+  }
+
+ private:
+  //! Ids of tags that are parsed.
+  enum Tag
+  {
+    Other,
+    Base,
+    ImageName,
+    Size,
+    Width,
+    Height,
+    Depth,
+    Object,
+    BoundingBox,
+    ClassName,
+    X1,
+    Y1,
+    X2,
+    Y2
+  };
+
+  //! Get the id of a tag name. Names are compared in place, so no string is
+  //! built for each tag.
+  Tag Lookup(const char* begin, const char* end) const
+  {
+    const size_t length = end - begin;
+    for (size_t i = 0; i < tags.size(); i++)
+    {
+      if (tags[i].first.length() == length &&
+          std::memcmp(tags[i].first.data(), begin, length) == 0)
+        return tags[i].second;
+    }
+
+    return Other;
+  }
+
+  //! Get the first occurrence of pattern in [begin, end) or end.
+  static const char* Find(const char* begin,
+                          const char* end,
+                          const char* pattern)
+  {
+    const size_t length = std::strlen(pattern);
+    const char* found = std::search(begin, end, pattern, pattern + length);
+    return found == end ? end : found + length - 1;
+  }
+
+  /**
+   * Stores the text of the element that is being closed, if the element is
+   * at a known position in the annotation.
+   */
+  void HandleText(const std::vector<Tag>& stack,
+                  const char* begin,
+                  const char* end,
+                  Annotation& annotation,
+                  double* object,
+                  bool& knownClass,
+                  bool& hasName,
+                  bool& hasSize) const
+  {
+    if (stack[0] != Base)
+      return;
+
+    const Tag tag = stack.back();
+    if (stack.size() == 2 && tag == ImageName)
+    {
+      annotation.imageName = Unescape(Trim(begin, end));
+      hasName = true;
+    }
+    else if (stack.size() == 3 && stack[1] == Size &&
+        (tag == Width || tag == Height || tag == Depth))
+    {
+      const size_t value = (size_t) std::strtol(begin, nullptr, 10);
+      if (tag == Width)
+        annotation.width = value;
+      else if (tag == Height)
+        annotation.height = value;
+      else
+        annotation.depth = value;
+
+      hasSize = true;
+    }
+    else if (stack.size() == 3 && stack[1] == Object && tag == ClassName)
+    {
+      std::unordered_map<std::string, size_t>::const_iterator it =
+          classMap.find(Unescape(Trim(begin, end)));
+      if (it != classMap.end())
+      {
+        object[0] = it->second;
+        knownClass = true;
+      }
+    }
+    else if (stack.size() == 4 && stack[1] == Object &&
+        stack[2] == BoundingBox && tag >= X1 && tag <= Y2)
+    {
+      // Coordinates are truncated to integers.
+      object[tag - X1 + 1] = (int) std::strtod(begin, nullptr);
+    }
+  }
+
+  //! Get the text in [begin, end) without surrounding whitespace.
+  static std::string Trim(const char* begin, const char* end)
+  {
+    while (begin < end && std::isspace((unsigned char) *begin))
+      begin++;
+    while (end > begin && std::isspace((unsigned char) end[-1]))
+      end--;
+
+    return std::string(begin, end);
+  }
+
+  //! Replaces the predefined XML entities.
+  static std::string Unescape(const std::string& text)
+  {
+    if (text.find('&') == std::string::npos)
+      return text;
+
+    static const char* entities[][2] = {{"&lt;", "<"}, {"&gt;", ">"},
+        {"&quot;", "\""}, {"&apos;", "'"}, {"&amp;", "&"}};
+    std::string result;
+    for (size_t i = 0; i < text.length(); i++)
+    {
+      bool replaced = false;
+      for (size_t e = 0; e < 5 && text[i] == '&'; e++)
+      {
+        const size_t length = std::strlen(entities[e][0]);
+        if (text.compare(i, length, entities[e][0]) == 0)
+        {
+          result += entities[e][1];
+          i += length - 1;
+          replaced = true;
+          break;
+        }
+      }
+
+      if (!replaced)
+        result += text[i];
+    }
+
+    return result;
+  }
+
+  //! Locally stored mapping from class names to labels.
+  std::unordered_map<std::string, size_t> classMap;
+
+  //! Locally stored tag names and their ids, in order of precedence.
+  std::vector<std::pair<std::string, Tag>> tags;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
@@ -0,0 +1,418 @@
+/**
+ * @file batch_prefetcher.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of BatchPrefetcher class that assembles mini-batches in a
+ * background thread.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_DATALOADER_BATCH_PREFETCHER_HPP
+#define MODELS_DATALOADER_BATCH_PREFETCHER_HPP
+
+#include <mlpack/core.hpp>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <mutex>
+#include <deque>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Assembles mini-batches of the training set in a background thread so that
+ * decoding, resizing, augmentation and pre-processing overlap with training.
+ * At most queueSize batches are held in memory. The producer runs across
+ * epochs, so the first batch of the next epoch is ready as soon as the last
+ * batch of the current epoch is consumed.
+ *
+ * @code
+ * DataLoader<> dataloader;
+ * dataloader.Lazy() = true;
+ * dataloader.LoadImageDatasetFromDirectory("path/to/directory", 32, 32, 3);
+ *
+ * BatchPrefetcher<> prefetcher(dataloader, 32);
+ * arma::mat features, labels;
+ * while (prefetcher.Next(features, labels))
+ * {
+ *   // Use the batch.
+ * }
+ * @endcode
+ *
+ * @tparam DatasetX Datatype for loading input features.
+ * @tparam DatasetY Datatype for prediction features.
+ */
+template<
+  typename DatasetX = arma::mat,
+  typename DatasetY = arma::mat
+>
+class BatchPrefetcher
+{
+ public:
+  //! Function that gathers the data points with the given indices.
+  typedef std::function<void(const arma::uvec&, DatasetX&, DatasetY&)>
+      BatchFunction;
+
+  //! Function applied to each batch after it is gathered.
+  typedef std::function<void(DatasetX&, DatasetY&)> TransformFunction;
+
+  /**
+   * Creates a prefetcher for any source of batches and starts producing
+   * batches of the first epoch.
+   *
+   * @param batchFunction Function that stores the data points with the given
+   *     indices in the passed features and labels.
+   * @param numPoints Number of data points in an epoch.
+   * @param batchSize Number of data points in a batch. The last batch of an
+   *     epoch may be smaller.
+   * @param queueSize Maximum number of batches prepared ahead of time.
+   * @param shuffle Boolean to determine whether or not to shuffle the data
+   *     points at the start of each epoch.
+   * @param transform Optional function applied to each batch, such as a
+   *     PreProcessor step.
+   */
+  BatchPrefetcher(const BatchFunction& batchFunction,
+                  const size_t numPoints,
+                  const size_t batchSize,
+                  const size_t queueSize = 2,
+                  const bool shuffle = true,
+                  const TransformFunction& transform = TransformFunction()) :
+      batchFunction(batchFunction),
+      transform(transform),
+      numPoints(numPoints),
+      batchSize(batchSize),
+      queueSize(queueSize),
+      shuffle(shuffle),
+      epoch(0),
+      epochStarted(false),
+      producerEpoch(0),
+      stop(false)
+  {
+    Start();
+  }
+
+  /**
+   * Creates a prefetcher for the training set of a DataLoader and starts
+   * producing batches of the first epoch. The DataLoader must outlive the
+   * prefetcher. If the DataLoader stores features of another type, such as
+   * 8-bit images, batches are converted to DatasetX. The index of the epoch
+   * is passed to DataLoader::TrainBatch(), so batch augmentations differ
+   * between epochs.
+   *
+   * @param dataloader DataLoader whose training set is used.
+   * @param batchSize Number of data points in a batch. The last batch of an
+   *     epoch may be smaller.
+   * @param queueSize Maximum number of batches prepared ahead of time.
+   * @param shuffle Boolean to determine whether or not to shuffle the data
+   *     points at the start of each epoch.
+   * @param transform Optional function applied to each batch, such as a
+   *     PreProcessor step.
+   */
+  template<
+      typename DataLoaderType,
+      typename = decltype(std::declval<const DataLoaderType&>().TrainSize())
+  >
+  BatchPrefetcher(const DataLoaderType& dataloader,
+                  const size_t batchSize,
+                  const size_t queueSize = 2,
+                  const bool shuffle = true,
+                  const TransformFunction& transform = TransformFunction()) :
+      BatchPrefetcher([this, &dataloader](const arma::uvec& indices,
+          DatasetX& features, DatasetY& labels)
+          {
+            LoadBatch(dataloader, indices, features, labels, producerEpoch);
+          }, dataloader.TrainSize(), batchSize, queueSize, shuffle, transform)
+  {
+    // Nothing to do here.
+  }
+
+  //! Stops the background thread.
+  ~BatchPrefetcher()
+  {
+    Stop();
+  }
+
+  /**
+   * Gets the next batch, waiting until it is ready. Errors raised while the
+   * batch was prepared are rethrown here.
+   *
+   * @param features Matrix where features of the batch will be stored.
+   * @param labels Matrix where labels of the batch will be stored.
+   * @param begin Index of the first data point of the batch in its epoch.
+   * @return false if the epoch has ended, in which case the next call returns
+   *     the first batch of the next epoch.
+   */
+  bool Next(DatasetX& features, DatasetY& labels, size_t& begin)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    notEmpty.wait(lock, [this] { return !queue.empty() || error; });
+
+    if (queue.empty())
+      std::rethrow_exception(error);
+
+    Batch batch = std::move(queue.front());
+    queue.pop_front();
+    notFull.notify_one();
+
+    if (batch.endOfEpoch)
+    {
+      epoch++;
+      epochStarted = false;
+      return false;
+    }
+
+    epochStarted = true;
+    features = std::move(batch.features);
+    labels = std::move(batch.labels);
+    begin = batch.begin;
+    return true;
+  }
+
+  //! Gets the next batch. See Next(features, labels, begin).
+  bool Next(DatasetX& features, DatasetY& labels)
+  {
+    size_t begin;
+    return Next(features, labels, begin);
+  }
+
+  /**
+   * Discards prepared batches and restarts from the first batch of a new
+   * epoch. The index of the epoch only advances if a batch of the current
+   * epoch was returned by Next(), so a Reset() at the end of an epoch doesn't
+   * skip an index.
+   */
+  void Reset()
+  {
+    Stop();
+    if (epochStarted)
+    {
+      epoch++;
+      epochStarted = false;
+    }
+    Start();
+  }
+
+  //! Get the index of the epoch whose batches are returned by Next().
+  size_t Epoch() const { return epoch; }
+
+  //! Get the number of data points in an epoch.
+  size_t NumPoints() const { return numPoints; }
+
+  //! Get the number of data points in a batch.
+  size_t BatchSize() const { return batchSize; }
+
+  //! Get the number of batches in an epoch.
+  size_t NumBatches() const
+  {
+    return batchSize == 0 ? 0 : (numPoints + batchSize - 1) / batchSize;
+  }
+
+ private:
+  /**
+   * Gathers a batch of the training set of a DataLoader and converts it to
+   * DatasetX.
+   *
+   * @param dataloader DataLoader whose training set is used.
+   * @param indices Indices of data points in the batch.
+   * @param features Matrix where features of the batch will be stored.
+   * @param labels Matrix where labels of the batch will be stored.
+   * @param epoch Index of the epoch of the batch.
+   */
+  template<typename DataLoaderType>
+  static void LoadBatch(const DataLoaderType& dataloader,
+                        const arma::uvec& indices,
+                        DatasetX& features,
+                        DatasetY& labels,
+                        const size_t epoch)
+  {
+    typename std::decay<decltype(dataloader.TrainFeatures())>::type batch;
+    dataloader.TrainBatch(indices, batch, labels, epoch);
+    ConvertBatch(batch, features);
+  }
+
+  //! Moves a batch that already has the type of features.
+  static void ConvertBatch(DatasetX& batch, DatasetX& features)
+  {
+    features = std::move(batch);
+  }
+
+  //! Converts a batch to the type of features.
+  template<typename BatchType>
+  static void ConvertBatch(const BatchType& batch, DatasetX& features)
+  {
+    features = arma::conv_to<DatasetX>::from(batch);
+  }
+
+  //! A prepared batch or the marker for the end of an epoch.
+  struct Batch
+  {
+    size_t begin;
+    bool endOfEpoch;
+    DatasetX features;
+    DatasetY labels;
+  };
+
+  //! Starts the background thread.
+  void Start()
+  {
+    mlpack::Log::Assert(batchSize > 0, "Batch size must be positive.");
+
+    stop = false;
+    error = std::exception_ptr();
+    producerEpoch = epoch;
+
+    // The producer shuffles with its own generator so that it doesn't share
+    // the global random state with the training thread.
+    const size_t seed = mlpack::math::RandInt(1 << 30);
+    producer = std::thread(&BatchPrefetcher::Produce, this, seed);
+  }
+
+  //! Stops the background thread and discards prepared batches.
+  void Stop()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+
+    notFull.notify_all();
+    if (producer.joinable())
+      producer.join();
+
+    queue.clear();
+  }
+
+  /**
+   * Adds a batch to the queue, waiting while the queue is full.
+   *
+   * @return false if the prefetcher is being stopped.
+   */
+  bool Push(Batch&& batch)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    notFull.wait(lock, [this] { return stop || queue.size() < queueSize; });
+    if (stop)
+      return false;
+
+    queue.push_back(std::move(batch));
+    notEmpty.notify_one();
+    return true;
+  }
+
+  /**
+   * Body of the background thread. Prepares batches epoch after epoch until
+   * the prefetcher is stopped.
+   *
+   * @param seed Seed of the generator used for shuffling.
+   */
+  void Produce(const size_t seed)
+  {
+    std::mt19937 generator(seed);
+    std::vector<arma::uword> order(numPoints);
+    for (size_t i = 0; i < numPoints; i++)
+      order[i] = i;
+
+    try
+    {
+      while (true)
+      {
+        if (shuffle)
+          std::shuffle(order.begin(), order.end(), generator);
+
+        for (size_t begin = 0; begin < numPoints; begin += batchSize)
+        {
+          const size_t size = std::min(batchSize, numPoints - begin);
+          const arma::uvec indices(order.data() + begin, size);
+
+          Batch batch;
+          batch.begin = begin;
+          batch.endOfEpoch = false;
+          batchFunction(indices, batch.features, batch.labels);
+          if (transform)
+            transform(batch.features, batch.labels);
+
+          if (!Push(std::move(batch)))
+            return;
+        }
+
+        producerEpoch++;
+
+        Batch endOfEpoch;
+        endOfEpoch.begin = numPoints;
+        endOfEpoch.endOfEpoch = true;
+        if (!Push(std::move(endOfEpoch)))
+          return;
+      }
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      error = std::current_exception();
+      notEmpty.notify_all();
+    }
+  }
+
+  //! Locally stored function used to gather batches.
+  BatchFunction batchFunction;
+
+  //! Locally stored function applied to each batch.
+  TransformFunction transform;
+
+  //! Locally stored number of data points in an epoch.
+  size_t numPoints;
+
+  //! Locally stored number of data points in a batch.
+  size_t batchSize;
+
+  //! Locally stored maximum number of prepared batches.
+  size_t queueSize;
+
+  //! Locally stored boolean to determine whether data points are shuffled.
+  bool shuffle;
+
+  //! Index of the epoch whose batches are returned by Next(). It advances
+  //! when Next() reaches the end of an epoch or Reset() interrupts one.
+  size_t epoch;
+
+  //! Boolean that is true if Next() returned a batch of the current epoch.
+  bool epochStarted;
+
+  //! Index of the epoch being prepared. Starts at epoch and is only used by
+  //! the background thread while it runs, which may be ahead of epoch.
+  size_t producerEpoch;
+
+  //! Prepared batches.
+  std::deque<Batch> queue;
+
+  //! Error raised by the background thread.
+  std::exception_ptr error;
+
+  //! Boolean to signal the background thread to stop.
+  bool stop;
+
+  //! Mutex guarding the queue, the error and stop.
+  std::mutex mutex;
+
+  //! Signalled when a batch is added to the queue.
+  std::condition_variable notEmpty;
+
+  //! Signalled when a batch is removed from the queue.
+  std::condition_variable notFull;
+
+  //! Background thread preparing batches.
+  std::thread producer;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
@@ -0,0 +1,378 @@
+/**
+ * @file csv_reader.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of CSVReader class for parsing numeric CSV files in parallel.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_DATALOADER_CSV_READER_HPP
+#define MODELS_DATALOADER_CSV_READER_HPP
+
+#include <mlpack/core.hpp>
+#include <utils/mapped_file.hpp>
+#include <utils/utils.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Reader for numeric CSV files. The file is memory-mapped and split into
+ * chunks of whole lines which are parsed in parallel. Each line is a data
+ * point, so it's stored as a column, and only the requested ranges of fields
+ * are stored. Empty lines are skipped, and fields that are missing or aren't
+ * numbers are stored as zero.
+ *
+ * @code
+ * CSVReader reader;
+ * if (reader.Open("path/to/file.csv"))
+ * {
+ *   arma::uvec columns = arma::linspace<arma::uvec>(0, reader.Rows() - 1,
+ *       reader.Rows());
+ *   arma::mat features, labels, unused;
+ *   reader.Read(columns, reader.Rows(), 0, reader.Cols() - 2,
+ *       reader.Cols() - 1, reader.Cols() - 1, features, labels, unused,
+ *       unused);
+ * }
+ * @endcode
+ */
+class CSVReader
+{
+ public:
+  /**
+   * Create a CSVReader object.
+   *
+   * @param chunkSize Approximate number of bytes parsed by a thread at once.
+   */
+  CSVReader(const size_t chunkSize = 1 << 22) :
+      chunkSize(std::max(chunkSize, (size_t) 1)),
+      cols(0)
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Maps the given file and finds the lines of each chunk in parallel.
+   *
+   * @param path Path to the CSV file.
+   * @param numThreads Number of threads used. If 0, all available threads
+   *     are used.
+   * @return true if the file was mapped else false.
+   */
+  bool Open(const std::string& path, const size_t numThreads = 0)
+  {
+    chunks.clear();
+    firstRows.clear();
+    cols = 0;
+    if (!file.Open(path))
+      return false;
+
+    // Chunks end after a newline, so that no line is split between chunks.
+    const char* data = file.Data();
+    const char* end = data + file.Size();
+    for (const char* begin = data; begin < end;)
+    {
+      const char* chunkEnd = begin + std::min(chunkSize,
+          (size_t) (end - begin));
+      chunkEnd = std::find(chunkEnd - 1, end, '\n');
+      chunkEnd = (chunkEnd == end) ? end : chunkEnd + 1;
+      chunks.push_back(std::make_pair(begin, chunkEnd));
+      begin = chunkEnd;
+    }
+
+    // Count the lines of each chunk to find the first data point of each
+    // chunk.
+    firstRows.resize(chunks.size() + 1, 0);
+    #pragma omp parallel for num_threads(Utils::NumThreads(numThreads)) \
+        schedule(dynamic)
+    for (omp_size_t i = 0; i < (omp_size_t) chunks.size(); i++)
+    {
+      size_t lines = 0;
+      for (const char* line = chunks[i].first; line < chunks[i].second;)
+      {
+        const char* lineEnd = LineEnd(line, chunks[i].second);
+        if (!IsEmpty(line, lineEnd))
+          lines++;
+
+        line = NextLine(lineEnd, chunks[i].second);
+      }
+
+      firstRows[i + 1] = lines;
+    }
+
+    for (size_t i = 1; i < firstRows.size(); i++)
+      firstRows[i] += firstRows[i - 1];
+
+    // The first line sets the number of fields.
+    for (const char* line = data; line < end && cols == 0;)
+    {
+      const char* lineEnd = LineEnd(line, end);
+      if (!IsEmpty(line, lineEnd))
+        cols = std::count(line, lineEnd, ',') + 1;
+
+      line = NextLine(lineEnd, end);
+    }
+
+    return true;
+  }
+
+  /**
+   * Parses the file in parallel. Fields inputBegin to inputEnd of each line
+   * are stored as features and fields labelBegin to labelEnd as labels, both
+   * ranges are inclusive. If labelEnd < labelBegin, no labels are stored.
+   * Line i is stored in column columns(i) of the first set if columns(i) <
+   * firstSize, else in column columns(i) - firstSize of the second set. Lines
+   * whose column is Skip() aren't parsed.
+   *
+   * @param columns Column of each line. Columns other than Skip() must be a
+   *     permutation of 0 to n - 1, where n is the number of stored lines.
+   * @param firstSize Number of data points in the first set.
+   * @param inputBegin First field stored as a feature.
+   * @param inputEnd Last field stored as a feature.
+   * @param labelBegin First field stored as a label.
+   * @param labelEnd Last field stored as a label.
+   * @param firstFeatures Matrix where features of the first set are stored.
+   * @param firstLabels Matrix where labels of the first set are stored.
+   * @param secondFeatures Matrix where features of the second set are stored.
+   * @param secondLabels Matrix where labels of the second set are stored.
+   * @param numThreads Number of threads used. If 0, all available threads
+   *     are used.
+   */
+  template<typename FeaturesType, typename LabelsType>
+  void Read(const arma::uvec& columns,
+            const size_t firstSize,
+            const size_t inputBegin,
+            const size_t inputEnd,
+            const size_t labelBegin,
+            const size_t labelEnd,
+            FeaturesType& firstFeatures,
+            LabelsType& firstLabels,
+            FeaturesType& secondFeatures,
+            LabelsType& secondLabels,
+            const size_t numThreads = 0) const
+  {
+    mlpack::Log::Assert(columns.n_elem == Rows(), "Number of columns must be "
+        "equal to the number of lines.");
+
+    const size_t storedRows = Rows() - std::count(columns.begin(),
+        columns.end(), Skip());
+    mlpack::Log::Assert(firstSize <= storedRows, "First set can't be larger "
+        "than the number of stored lines.");
+
+    const size_t inputRows = inputBegin <= inputEnd ?
+        inputEnd - inputBegin + 1 : 0;
+    const size_t labelRows = labelBegin <= labelEnd ?
+        labelEnd - labelBegin + 1 : 0;
+
+    firstFeatures.zeros(inputRows, firstSize);
+    secondFeatures.zeros(inputRows, storedRows - firstSize);
+    firstLabels.zeros(labelRows, firstSize);
+    secondLabels.zeros(labelRows, storedRows - firstSize);
+
+    #pragma omp parallel for num_threads(Utils::NumThreads(numThreads)) \
+        schedule(dynamic)
+    for (omp_size_t i = 0; i < (omp_size_t) chunks.size(); i++)
+    {
+      size_t row = firstRows[i];
+      for (const char* line = chunks[i].first; line < chunks[i].second;)
+      {
+        const char* lineEnd = LineEnd(line, chunks[i].second);
+        if (IsEmpty(line, lineEnd))
+        {
+          line = NextLine(lineEnd, chunks[i].second);
+          continue;
+        }
+
+        const size_t column = columns(row++);
+        if (column == Skip())
+        {
+          line = NextLine(lineEnd, chunks[i].second);
+          continue;
+        }
+
+        const bool first = column < firstSize;
+        FeaturesType& features = first ? firstFeatures : secondFeatures;
+        LabelsType& labels = first ? firstLabels : secondLabels;
+        const size_t col = first ? column : column - firstSize;
+
+        // Fields outside of both ranges are skipped without being parsed.
+        // Indices before the start of a range wrap around, so a single
+        // comparison checks both bounds.
+        const char* field = line;
+        for (size_t f = 0; field <= lineEnd; f++)
+        {
+          const char* fieldEnd = std::find(field, lineEnd, ',');
+          if (f - inputBegin < inputRows)
+          {
+            features(f - inputBegin, col) = static_cast<typename
+                FeaturesType::elem_type>(ParseDouble(field, fieldEnd));
+          }
+
+          if (f - labelBegin < labelRows)
+          {
+            labels(f - labelBegin, col) = static_cast<typename
+                LabelsType::elem_type>(ParseDouble(field, fieldEnd));
+          }
+
+          field = fieldEnd + 1;
+        }
+
+        line = NextLine(lineEnd, chunks[i].second);
+      }
+    }
+  }
+
+  //! Get the number of data points i.e. non-empty lines.
+  size_t Rows() const { return firstRows.empty() ? 0 : firstRows.back(); }
+
+  //! Get the number of fields in the first line.
+  size_t Cols() const { return cols; }
+
+  //! Get the column of lines that aren't stored.
+  static arma::uword Skip() { return std::numeric_limits<arma::uword>::max(); }
+
+  /**
+   * Parses a number. Numbers with at most 15 significant digits and small
+   * exponents are converted exactly without strtod(), other numbers fall
+   * back to strtod().
+   *
+   * @param begin First character of the field.
+   * @param end Character after the last character of the field.
+   * @return Parsed number, or zero if the field isn't a number.
+   */
+  static double ParseDouble(const char* begin, const char* end)
+  {
+    while (begin < end && std::isspace((unsigned char) *begin))
+      begin++;
+    while (end > begin && std::isspace((unsigned char) end[-1]))
+      end--;
+
+    if (begin == end)
+      return 0.0;
+
+    const char* c = begin;
+    const bool negative = (*c == '-');
+    if (*c == '-' || *c == '+')
+      c++;
+
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool anyDigit = false;
+    for (; c < end && std::isdigit((unsigned char) *c); c++, anyDigit = true)
+    {
+      if (mantissa == 0 && *c == '0')
+        continue;
+
+      mantissa = mantissa * 10 + (*c - '0');
+      digits++;
+    }
+
+    if (c < end && *c == '.')
+    {
+      for (c++; c < end && std::isdigit((unsigned char) *c); c++,
+          anyDigit = true)
+      {
+        exponent--;
+        if (mantissa == 0 && *c == '0')
+          continue;
+
+        mantissa = mantissa * 10 + (*c - '0');
+        digits++;
+      }
+    }
+
+    if (anyDigit && c < end && (*c == 'e' || *c == 'E'))
+    {
+      const char* e = c + 1;
+      const bool negativeExponent = (e < end && *e == '-');
+      if (e < end && (*e == '-' || *e == '+'))
+        e++;
+
+      int value = 0;
+      const char* digitsBegin = e;
+      for (; e < end && std::isdigit((unsigned char) *e) && value < 100000;
+          e++)
+      {
+        value = value * 10 + (*e - '0');
+      }
+
+      if (e > digitsBegin)
+      {
+        exponent += negativeExponent ? -value : value;
+        c = e;
+      }
+    }
+
+    // Mantissas of up to 15 digits and powers of 10 up to 22 are exact
+    // doubles, so a single multiplication or division is correctly rounded.
+    static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+        1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+        1e20, 1e21, 1e22};
+    if (anyDigit && c == end && digits <= 15 && exponent >= -22 &&
+        exponent <= 22)
+    {
+      const double value = (exponent < 0) ? mantissa / powers[-exponent] :
+          mantissa * powers[exponent];
+      return negative ? -value : value;
+    }
+
+    // Fall back to strtod() for other numbers, inf and nan.
+    const std::string field(begin, end);
+    char* parsedEnd = nullptr;
+    const double value = std::strtod(field.c_str(), &parsedEnd);
+    return (parsedEnd == field.c_str() + field.length()) ? value : 0.0;
+  }
+
+ private:
+  //! Get the end of the line starting at begin.
+  static const char* LineEnd(const char* begin, const char* end)
+  {
+    return std::find(begin, end, '\n');
+  }
+
+  //! Get the start of the line after the line ending at lineEnd.
+  static const char* NextLine(const char* lineEnd, const char* end)
+  {
+    return lineEnd < end ? lineEnd + 1 : end;
+  }
+
+  //! Returns true if the line only has whitespace.
+  static bool IsEmpty(const char* begin, const char* end)
+  {
+    for (; begin < end; begin++)
+    {
+      if (!std::isspace((unsigned char) *begin))
+        return false;
+    }
+
+    return true;
+  }
+
+  //! Locally stored approximate size of a chunk in bytes.
+  size_t chunkSize;
+
+  //! Locally stored number of fields in the first line.
+  size_t cols;
+
+  //! Mapped CSV file.
+  MappedFile file;
+
+  //! First and last character of each chunk.
+  std::vector<std::pair<const char*, const char*>> chunks;
+
+  //! Index of the first data point of each chunk.
+  std::vector<size_t> firstRows;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
@@ -13,16 +13,19 @@
 #define MODELS_DATALOADER_DATALOADER_HPP
 
 #include <mlpack/core/data/scaler_methods/min_max_scaler.hpp>
-#include <boost/property_tree/xml_parser.hpp>
 #include <mlpack/core/math/shuffle_data.hpp>
 #include <mlpack/core/data/split_data.hpp>
-#include <boost/property_tree/ptree.hpp>
 #include <augmentation/augmentation.hpp>
+#include <augmentation/detection_augmentation.hpp>
+#include <dataloader/annotation_parser.hpp>
+#include <dataloader/csv_reader.hpp>
+#include <dataloader/lazy_dataset.hpp>
+#include <dataloader/dataset_cache.hpp>
 #include <dataloader/datasets.hpp>
 #include <mlpack/prereqs.hpp>
-#include <boost/foreach.hpp>
 #include <mlpack/core.hpp>
 #include <utils/utils.hpp>
+#include <random>
 #include <set>
 
 namespace mlpack {
@@ -48,6 +51,52 @@ namespace models {
  * // Use the dataloader for prediction.
  * model.Predict(dataloader.TestFeatures(), dataloader.TestLabels());
  * @endcode
+ *
+ * Image datasets can also be loaded lazily, in which case only paths of
+ * images and their labels are held in memory and images are decoded one
+ * batch at a time.
+ *
+ * @code
+ * DataLoader<> dataloader;
+ * dataloader.Lazy() = true;
+ * dataloader.LoadImageDatasetFromDirectory("path/to/directory", 32, 32, 3);
+ *
+ * arma::mat features, labels;
+ * for (size_t i = 0; i < dataloader.TrainSize(); i += batchSize)
+ *   dataloader.TrainBatch(i, batchSize, features, labels);
+ * @endcode
+ *
+ * Images can be stored as 8-bit pixels, which use 8 times less memory than
+ * doubles, and converted to the type used by the model one batch at a time.
+ *
+ * @code
+ * DataLoader<arma::Mat<uint8_t>> dataloader;
+ * dataloader.LoadImageDatasetFromDirectory("path/to/directory", 32, 32, 3);
+ *
+ * arma::Mat<uint8_t> images;
+ * arma::mat features, labels;
+ * dataloader.TrainBatch(0, batchSize, images, labels);
+ * PreProcessor<>::ConvertImages(images, features, 1.0 / 255,
+ *     {0.485, 0.456, 0.406});
+ * @endcode
+ *
+ * Augmentations can be applied to each training batch instead of the loaded
+ * training set, so that every epoch sees new augmentations. Batches are
+ * reproducible from the augmentation seed and the epoch.
+ *
+ * @code
+ * DataLoader<> dataloader;
+ * dataloader.AugmentBatches() = true;
+ * dataloader.AugmentationSeed() = 42;
+ * dataloader.LoadImageDatasetFromDirectory("path/to/directory", 32, 32, 3,
+ *     true, 0.2, true, {"horizontal-flip", "random-crop (4)"}, 0.5);
+ *
+ * for (size_t epoch = 0; epoch < epochs; epoch++)
+ * {
+ *   for (size_t i = 0; i + batchSize <= dataloader.TrainSize(); i += batchSize)
+ *     dataloader.TrainBatch(i, batchSize, features, labels, epoch);
+ * }
+ * @endcode
  * 
  * @tparam DatasetX Datatype for loading input features.
  * @tparam DatasetY Datatype for prediction features.
@@ -74,6 +123,8 @@ class DataLoader
    * @param useScaler Use feature scaler for pre-processing the dataset.
    * @param augmentation Adds augmentation to training data only.
    * @param augmentationProbability Probability of applying augmentation on dataset.
+   * @param cachePath Directory where decoded image datasets are cached. If
+   *     empty, images are decoded every time they are loaded.
    */
   DataLoader(const std::string& dataset,
              const bool shuffle,
@@ -81,11 +132,15 @@ class DataLoader
              const bool useScaler = true,
              const std::vector<std::string> augmentation =
                  std::vector<std::string>(),
-             const double augmentationProbability = 0.2);
+             const double augmentationProbability = 0.2,
+             const std::string& cachePath = "");
 
   /**
    * Function to load and preprocess train or test data stored in CSV files.
-   * 
+   * The file is parsed in parallel chunks and only the requested fields are
+   * stored, straight into the training and validation sets. Use NumThreads()
+   * to control the number of threads used for parsing.
+   *
    * @param datasetPath Path to the dataset.
    * @param loadTrainData Boolean to determine whether data will be stored for
    *                      training or testing. If true, data will be loaded for training.
@@ -136,6 +191,10 @@ class DataLoader
    * NOTE : Labels are assigned using classes vector. Set verbose to 1 to print labels
    * and their corresponding class. The labels type should be field type here.
    *
+   * Annotation files are parsed and images are decoded in parallel, use
+   * NumThreads() to control the number of threads. Annotation files that
+   * can't be parsed are skipped.
+   *
    * @param pathToAnnotations Path to the folder containing XML type annotation files.
    * @param pathToImages Path to folder containing images corresponding to annotations.
    * @param classes Vector of strings containing list of classes. Labels are assigned
@@ -143,6 +202,13 @@ class DataLoader
    * @param validRatio Ratio of dataset that will be used for validation.
    * @param shuffle Boolean to determine whether the dataset is shuffled.
    * @param augmentation Vector strings of augmentations supported by mlpack.
+   *                     Augmentations supported by DetectionAugmentation,
+   *                     such as flips and "random-resized-crop (minScale)",
+   *                     also transform the bounding boxes of the image. With
+   *                     "letterbox (width, height)" instead of resize,
+   *                     images keep their aspect ratio and are padded;
+   *                     Augmentation::GetResize() gives the scale and offset
+   *                     that map predictions back to the source image.
    * @param augmentationProbability Probability of applying augmentation
    *                                to a particular image.
    * @param absolutePath Boolean to determine if absolute path is used. Defaults to false.
@@ -184,7 +250,11 @@ class DataLoader
                                   const std::string& y2XMLTag = "ymax");
 
   /**
-   * Load all images from directory.
+   * Load all images from directory. Images are decoded in parallel into a
+   * dataset that is allocated only once, use NumThreads() to control the
+   * number of threads used for decoding. If CachePath() is set and the
+   * dataset is empty, decoded images are cached there and later loads map
+   * the cache instead of decoding the images.
    *
    * @param imagesPath Path to all images.
    * @param dataset Armadillo type where images will be loaded.
@@ -206,7 +276,10 @@ class DataLoader
                                   const size_t label = 0);
 
   /**
-   * Load all images from directory.
+   * Load all images from directory. If CachePath() is set, decoded and
+   * resized images are cached there and later loads map the cache instead of
+   * decoding the images. The cache is invalidated when an image, its
+   * modification time or the output shape changes.
    *
    * @param pathToDataset Path to all folders containing all images.
    * @param imageWidth Width of images in dataset.
@@ -232,59 +305,321 @@ class DataLoader
                                         0.2);
 
   //! Get the training dataset features.
-  DatasetX TrainFeatures() const { return trainFeatures; }
+  const DatasetX& TrainFeatures() const { return trainFeatures; }
 
   //! Modify the training dataset features.
   DatasetX& TrainFeatures() { return trainFeatures; }
 
   //! Get the training dataset labels.
-  DatasetY TrainLabels() const { return trainLabels; }
+  const DatasetY& TrainLabels() const { return trainLabels; }
   //! Modify the training dataset labels.
   DatasetY& TrainLabels() { return trainLabels; }
 
   //! Get the test dataset features.
-  DatasetX TestFeatures() const { return testFeatures; }
+  const DatasetX& TestFeatures() const { return testFeatures; }
   //! Modify the test dataset features.
   DatasetX& TestFeatures() { return testFeatures; }
 
   //! Get the test dataset labels.
-  DatasetY TestLabels() const { return testLabels; }
+  const DatasetY& TestLabels() const { return testLabels; }
   //! Modify the test dataset labels.
   DatasetY& TestLabels() { return testLabels; }
 
   //! Get the validation dataset features.
-  DatasetX ValidFeatures() const { return validFeatures; }
+  const DatasetX& ValidFeatures() const { return validFeatures; }
   //! Modify the validation dataset features.
   DatasetX& ValidFeatures() { return validFeatures; }
 
   //! Get the validation dataset labels.
-  DatasetY ValidLabels() const { return validLabels; }
+  const DatasetY& ValidLabels() const { return validLabels; }
   //! Modify the validation dataset labels.
   DatasetY& ValidLabels() { return validLabels; }
 
-  //! Get the training dataset.
-  std::tuple<DatasetX, DatasetY> TrainSet() const
+  //! Get the training dataset. Features and labels aren't copied.
+  std::tuple<const DatasetX&, const DatasetY&> TrainSet() const
+  {
+    return std::tuple<const DatasetX&, const DatasetY&>(trainFeatures,
+        trainLabels);
+  }
+
+  //! Get the validation dataset. Features and labels aren't copied.
+  std::tuple<const DatasetX&, const DatasetY&> ValidSet() const
   {
-    return std::tuple<DatasetX, DatasetY>(trainFeatures, trainLabels);
+    return std::tuple<const DatasetX&, const DatasetY&>(validFeatures,
+        validLabels);
   }
 
-  //! Get the validation dataset.
-  std::tuple<DatasetX, DatasetY> ValidSet() const
+  //! Get the testing dataset. Features and labels aren't copied.
+  std::tuple<const DatasetX&, const DatasetY&> TestSet() const
   {
-    return std::tuple<DatasetX, DatasetY>(validFeatures, validLabels);
+    return std::tuple<const DatasetX&, const DatasetY&>(testFeatures,
+        testLabels);
   }
 
-  //! Get the testing dataset.
-  std::tuple<DatasetX, DatasetY> TestSet() const
+  /**
+   * Moves the training dataset out of the DataLoader without copying it.
+   * The training features and labels of the DataLoader are empty afterwards.
+   *
+   * @code
+   * arma::mat trainX, trainY;
+   * std::tie(trainX, trainY) = dataloader.ReleaseTrainSet();
+   * @endcode
+   */
+  std::tuple<DatasetX, DatasetY> ReleaseTrainSet()
   {
-    return std::tuple<DatasetX, DatasetY>(testFeatures, testLabels);
+    return std::tuple<DatasetX, DatasetY>(std::move(trainFeatures),
+        std::move(trainLabels));
+  }
+
+  /**
+   * Moves the validation dataset out of the DataLoader without copying it.
+   * The validation features and labels of the DataLoader are empty
+   * afterwards.
+   */
+  std::tuple<DatasetX, DatasetY> ReleaseValidSet()
+  {
+    return std::tuple<DatasetX, DatasetY>(std::move(validFeatures),
+        std::move(validLabels));
+  }
+
+  /**
+   * Moves the testing dataset out of the DataLoader without copying it.
+   * The testing features and labels of the DataLoader are empty afterwards.
+   */
+  std::tuple<DatasetX, DatasetY> ReleaseTestSet()
+  {
+    return std::tuple<DatasetX, DatasetY>(std::move(testFeatures),
+        std::move(testLabels));
   }
 
   //! Get the Scaler.
-  ScalerType Scaler() const { return scaler; }
+  const ScalerType& Scaler() const { return scaler; }
   //! Modify the Scaler.
   ScalerType& Scaler() { return scaler; }
 
+  //! Get the number of threads used for loading data (0 uses all threads).
+  size_t NumThreads() const { return numThreads; }
+  //! Modify the number of threads used for loading data.
+  size_t& NumThreads() { return numThreads; }
+
+  //! Get the directory where decoded image datasets are cached.
+  const std::string& CachePath() const { return cachePath; }
+  //! Modify the directory where decoded image datasets are cached. If empty,
+  //! images are decoded every time they are loaded.
+  std::string& CachePath() { return cachePath; }
+
+  //! Get whether image datasets are decoded one batch at a time.
+  bool Lazy() const { return lazy; }
+  //! Modify whether image datasets are decoded one batch at a time.
+  bool& Lazy() { return lazy; }
+
+  //! Get whether augmentations are applied to training batches instead of
+  //! the loaded training set.
+  bool AugmentBatches() const { return augmentBatches; }
+  //! Modify whether augmentations are applied to training batches instead of
+  //! the loaded training set. Lazily loaded datasets are always augmented
+  //! one batch at a time. Set it before the dataset is loaded.
+  bool& AugmentBatches() { return augmentBatches; }
+
+  //! Get the seed of augmentations applied to training batches.
+  size_t AugmentationSeed() const { return augmentationSeed; }
+  //! Modify the seed of augmentations applied to training batches.
+  size_t& AugmentationSeed() { return augmentationSeed; }
+
+  //! Get the augmentations applied to training batches, empty if the
+  //! training set was augmented when it was loaded.
+  const AugmentationPipeline& BatchAugmentation() const
+  {
+    return batchAugmentation;
+  }
+
+  //! Get the geometric augmentations applied to images and bounding boxes of
+  //! training batches of an object detection dataset.
+  const DetectionAugmentation& BatchDetectionAugmentation() const
+  {
+    return batchDetectionAugmentation;
+  }
+
+  /**
+   * Makes this DataLoader keep only its shard of every dataset loaded
+   * afterwards, for data-parallel training with worldSize processes. Data
+   * points are assigned to shards using a permutation generated from seed,
+   * so processes using the same seed get disjoint shards that cover the
+   * dataset. Files and CSV lines outside of the shard are never decoded or
+   * stored. To reshuffle data points between shards every epoch, reload the
+   * dataset with seed + epoch, which is cheap if Lazy() is set.
+   *
+   * A scaler fitted on a shard only sees the statistics of that shard, so
+   * processes would scale features differently. Fit the scaler once on the
+   * whole dataset, give a copy to each process through Scaler() and set
+   * FitScaler() to false, so that every process only transforms its shard
+   * with the shared scaler.
+   *
+   * @param rank Index of this process, from 0 to worldSize - 1.
+   * @param worldSize Number of processes. 1 disables sharding.
+   * @param seed Seed of the permutation that assigns data points to shards.
+   */
+  void Shard(const size_t rank, const size_t worldSize, const size_t seed = 0)
+  {
+    if (worldSize == 0 || rank >= worldSize)
+    {
+      mlpack::Log::Fatal << "Rank of the shard (" << rank << ") must be less "
+          << "than the number of shards (" << worldSize << ")." << std::endl;
+    }
+
+    this->rank = rank;
+    this->worldSize = worldSize;
+    this->shardSeed = seed;
+  }
+
+  //! Get the index of the shard that is loaded.
+  size_t Rank() const { return rank; }
+
+  //! Get the number of shards.
+  size_t WorldSize() const { return worldSize; }
+
+  //! Get the seed of the permutation that assigns data points to shards.
+  size_t ShardSeed() const { return shardSeed; }
+
+  //! Get whether the scaler is fitted on training features when a dataset is
+  //! loaded. If false, Scaler() must already be fitted, e.g. on the whole
+  //! dataset when loading a shard.
+  bool FitScaler() const { return fitScaler; }
+  //! Modify whether the scaler is fitted on training features.
+  bool& FitScaler() { return fitScaler; }
+
+  //! Get the number of data points in the training set.
+  size_t TrainSize() const
+  {
+    return trainImages.Size() > 0 ? trainImages.Size() : trainFeatures.n_cols;
+  }
+
+  //! Get the number of data points in the validation set.
+  size_t ValidSize() const
+  {
+    return validImages.Size() > 0 ? validImages.Size() : validFeatures.n_cols;
+  }
+
+  //! Get the number of data points in the testing set.
+  size_t TestSize() const
+  {
+    return testImages.Size() > 0 ? testImages.Size() : testFeatures.n_cols;
+  }
+
+  //! Get the lazily loaded training images.
+  const LazyDataset<DatasetX>& TrainImages() const { return trainImages; }
+  //! Get the lazily loaded validation images.
+  const LazyDataset<DatasetX>& ValidImages() const { return validImages; }
+  //! Get the lazily loaded testing images.
+  const LazyDataset<DatasetX>& TestImages() const { return testImages; }
+
+  /**
+   * Get a batch of the training set. If the dataset was loaded lazily,
+   * images are decoded here. If BatchAugmentation() isn't empty, the batch
+   * is augmented here. Each data point is augmented with its own random
+   * generator, seeded from AugmentationSeed(), the epoch and the index of the
+   * data point, so a data point is augmented the same way in an epoch
+   * regardless of the batch it's in and of the number of threads.
+   *
+   * @param indices Indices of data points in the training set.
+   * @param features Matrix where features of the batch will be stored.
+   * @param labels Matrix where labels of the batch will be stored.
+   * @param epoch Index of the epoch, used to draw new augmentations every
+   *     epoch.
+   */
+  void TrainBatch(const arma::uvec& indices,
+                  DatasetX& features,
+                  DatasetY& labels,
+                  const size_t epoch = 0) const
+  {
+    Batch(trainImages, trainFeatures, trainLabels, indices, features, labels,
+        true, epoch);
+  }
+
+  /**
+   * Get a batch of consecutive data points of the training set.
+   *
+   * @param begin Index of the first data point of the batch.
+   * @param batchSize Number of data points in the batch.
+   * @param features Matrix where features of the batch will be stored.
+   * @param labels Matrix where labels of the batch will be stored.
+   * @param epoch Index of the epoch, used to draw new augmentations every
+   *     epoch.
+   */
+  void TrainBatch(const size_t begin,
+                  const size_t batchSize,
+                  DatasetX& features,
+                  DatasetY& labels,
+                  const size_t epoch = 0) const
+  {
+    TrainBatch(BatchIndices(begin, batchSize, TrainSize()), features, labels,
+        epoch);
+  }
+
+  /**
+   * Get a batch of the validation set. If the dataset was loaded lazily,
+   * images are decoded here.
+   *
+   * @param indices Indices of data points in the validation set.
+   * @param features Matrix where features of the batch will be stored.
+   * @param labels Matrix where labels of the batch will be stored.
+   */
+  void ValidBatch(const arma::uvec& indices,
+                  DatasetX& features,
+                  DatasetY& labels) const
+  {
+    Batch(validImages, validFeatures, validLabels, indices, features, labels,
+        false, 0);
+  }
+
+  /**
+   * Get a batch of consecutive data points of the validation set.
+   *
+   * @param begin Index of the first data point of the batch.
+   * @param batchSize Number of data points in the batch.
+   * @param features Matrix where features of the batch will be stored.
+   * @param labels Matrix where labels of the batch will be stored.
+   */
+  void ValidBatch(const size_t begin,
+                  const size_t batchSize,
+                  DatasetX& features,
+                  DatasetY& labels) const
+  {
+    ValidBatch(BatchIndices(begin, batchSize, ValidSize()), features, labels);
+  }
+
+  /**
+   * Get a batch of the testing set. If the dataset was loaded lazily,
+   * images are decoded here.
+   *
+   * @param indices Indices of data points in the testing set.
+   * @param features Matrix where features of the batch will be stored.
+   * @param labels Matrix where labels of the batch will be stored.
+   */
+  void TestBatch(const arma::uvec& indices,
+                 DatasetX& features,
+                 DatasetY& labels) const
+  {
+    Batch(testImages, testFeatures, testLabels, indices, features, labels,
+        false, 0);
+  }
+
+  /**
+   * Get a batch of consecutive data points of the testing set.
+   *
+   * @param begin Index of the first data point of the batch.
+   * @param batchSize Number of data points in the batch.
+   * @param features Matrix where features of the batch will be stored.
+   * @param labels Matrix where labels of the batch will be stored.
+   */
+  void TestBatch(const size_t begin,
+                 const size_t batchSize,
+                 DatasetX& features,
+                 DatasetY& labels) const
+  {
+    TestBatch(BatchIndices(begin, batchSize, TestSize()), features, labels);
+  }
+
  private:
   /**
    * Downloads and checks hash for given dataset.
@@ -355,6 +690,551 @@ class DataLoader
     datasetMap.insert({"cifar10", Datasets<DatasetX, DatasetY>::CIFAR10()});
   }
 
+  /**
+   * Appends paths of all supported images in a directory.
+   *
+   * @param imagesPath Path to the directory containing images.
+   * @param imagePaths Vector to which paths of images will be appended.
+   * @param imageLabels Vector to which label of each image will be appended.
+   * @param label Label which will be assigned to images in the directory.
+   */
+  void ListImages(const std::string& imagesPath,
+                  std::vector<std::string>& imagePaths,
+                  std::vector<size_t>& imageLabels,
+                  const size_t label);
+
+  /**
+   * Decodes images into a dataset that is allocated once. Images are decoded
+   * in parallel, each into its own column. The layout matches inserting each
+   * image at the front of the dataset i.e. columns are in the reverse order of
+   * imagePaths and images whose size differs from the rest of the dataset are
+   * skipped.
+   *
+   * @param imagePaths Paths of images that will be loaded.
+   * @param imageLabels Label of each image.
+   * @param dataset Armadillo type where images will be loaded. If it isn't
+   *     empty, loaded images are placed in front of the existing ones.
+   * @param labels Armadillo type where labels will be loaded.
+   * @param imageWidth Width of images in dataset.
+   * @param imageHeight Height of images in dataset.
+   * @param imageDepth Depth of images in dataset.
+   */
+  void LoadImages(const std::vector<std::string>& imagePaths,
+                  const std::vector<size_t>& imageLabels,
+                  DatasetX& dataset,
+                  DatasetY& labels,
+                  const size_t imageWidth,
+                  const size_t imageHeight,
+                  const size_t imageDepth);
+
+  /**
+   * Get indices of a batch of consecutive data points.
+   *
+   * @param begin Index of the first data point of the batch.
+   * @param batchSize Number of data points in the batch.
+   * @param size Number of data points in the set.
+   */
+  static arma::uvec BatchIndices(const size_t begin,
+                                 const size_t batchSize,
+                                 const size_t size)
+  {
+    mlpack::Log::Assert(begin + batchSize <= size, "Batch is out of bounds.");
+    if (batchSize == 0)
+      return arma::uvec();
+
+    return arma::linspace<arma::uvec>(begin, begin + batchSize - 1,
+        batchSize);
+  }
+
+  /**
+   * Gathers a batch of data points, decoding images if they were loaded
+   * lazily and applying batch augmentations.
+   *
+   * @param images Lazily loaded images of the set, empty if the set was
+   *     loaded eagerly.
+   * @param setFeatures Features of the set, used if images is empty.
+   * @param setLabels Labels of the set.
+   * @param indices Indices of data points in the batch.
+   * @param features Matrix where features of the batch will be stored.
+   * @param labels Matrix where labels of the batch will be stored.
+   * @param augment Whether batch augmentations are applied.
+   * @param epoch Index of the epoch.
+   */
+  void Batch(const LazyDataset<DatasetX>& images,
+             const DatasetX& setFeatures,
+             const DatasetY& setLabels,
+             const arma::uvec& indices,
+             DatasetX& features,
+             DatasetY& labels,
+             const bool augment,
+             const size_t epoch) const
+  {
+    if (images.Size() > 0)
+      images.Load(indices, features, numThreads);
+    else
+      features = setFeatures.cols(indices);
+
+    GatherLabels(setLabels, indices, labels);
+    if (!augment || (batchAugmentation.Empty() &&
+        batchDetectionAugmentation.Empty()))
+    {
+      return;
+    }
+
+    // Data points get new streams of random numbers every epoch.
+    const uint64_t seed = augmentationSeed;
+    std::seed_seq sequence{(uint32_t) seed, (uint32_t) (seed >> 32),
+        (uint32_t) epoch, (uint32_t) ((uint64_t) epoch >> 32)};
+    uint32_t epochSeeds[4];
+    sequence.generate(epochSeeds, epochSeeds + 4);
+    batchAugmentation.Apply(features, ((uint64_t) epochSeeds[1] << 32) |
+        epochSeeds[0], indices, numThreads);
+    batchDetectionAugmentation.Apply(features, labels,
+        ((uint64_t) epochSeeds[3] << 32) | epochSeeds[2], indices, numThreads);
+  }
+
+  /**
+   * Copies the given columns of labels. Labels can be a matrix or a field, so
+   * they are copied element-wise.
+   *
+   * @param setLabels Labels of the set.
+   * @param indices Indices of columns that will be copied.
+   * @param labels Matrix where the columns will be stored.
+   */
+  static void GatherLabels(const DatasetY& setLabels,
+                           const arma::uvec& indices,
+                           DatasetY& labels)
+  {
+    labels.set_size(setLabels.n_rows, indices.n_elem);
+    for (size_t i = 0; i < indices.n_elem; i++)
+    {
+      for (size_t j = 0; j < setLabels.n_rows; j++)
+        labels(j, i) = setLabels(j, indices(i));
+    }
+  }
+
+  /**
+   * Get indices of the data points in the shard of this DataLoader, in
+   * increasing order. Every process generates the same permutation of all
+   * data points from the seed, and shard r holds the data points at
+   * positions r, r + worldSize, r + 2 * worldSize, ... of the permutation.
+   * The permutation is generated without standard library distributions,
+   * so it's the same on every platform.
+   *
+   * @param size Number of data points in the dataset.
+   */
+  arma::uvec ShardIndices(const size_t size) const
+  {
+    if (size == 0)
+      return arma::uvec();
+
+    arma::uvec indices = arma::linspace<arma::uvec>(0, size - 1, size);
+    if (worldSize <= 1)
+      return indices;
+
+    std::mt19937_64 generator(shardSeed);
+    for (size_t i = size - 1; i > 0; i--)
+      std::swap(indices(i), indices(generator() % (i + 1)));
+
+    const size_t shardSize = (size - rank + worldSize - 1) / worldSize;
+    arma::uvec shard(shardSize);
+    for (size_t i = 0; i < shardSize; i++)
+      shard(i) = indices(rank + i * worldSize);
+
+    return arma::sort(shard);
+  }
+
+  /**
+   * Keeps only the elements in the shard of this DataLoader.
+   *
+   * @param items Elements of the whole dataset e.g. paths of images.
+   */
+  template<typename ItemType>
+  void KeepShard(std::vector<ItemType>& items) const
+  {
+    if (worldSize <= 1)
+      return;
+
+    const arma::uvec shard = ShardIndices(items.size());
+    for (size_t i = 0; i < shard.n_elem; i++)
+    {
+      if (shard(i) != i)
+        items[i] = std::move(items[shard(i)]);
+    }
+
+    items.resize(shard.n_elem);
+  }
+
+  /**
+   * Get the order in which data points are split into training and
+   * validation sets. Uses the same permutation as mlpack::data::Split().
+   *
+   * @param size Number of data points.
+   * @param shuffle Boolean to determine whether or not to shuffle the data.
+   */
+  static arma::uvec SplitOrder(const size_t size, const bool shuffle)
+  {
+    if (size == 0)
+      return arma::uvec();
+
+    const arma::uvec order = arma::linspace<arma::uvec>(0, size - 1, size);
+    return shuffle ? arma::uvec(arma::shuffle(order)) : order;
+  }
+
+  /**
+   * Copies rows firstRow to lastRow of the given columns of input into
+   * output. Columns are copied in parallel and output is allocated once.
+   *
+   * @param input Matrix whose columns are copied.
+   * @param indices Indices of columns that will be copied.
+   * @param firstRow First row that will be copied.
+   * @param lastRow Last row that will be copied.
+   * @param output Matrix where the columns will be stored.
+   */
+  template<typename InputType, typename OutputType>
+  void GatherColumns(const InputType& input,
+                     const arma::uvec& indices,
+                     const size_t firstRow,
+                     const size_t lastRow,
+                     OutputType& output) const
+  {
+    output.set_size(lastRow - firstRow + 1, indices.n_elem);
+
+    #pragma omp parallel for num_threads(Utils::NumThreads(numThreads))
+    for (omp_size_t i = 0; i < (omp_size_t) indices.n_elem; i++)
+    {
+      const typename InputType::elem_type* column =
+          input.colptr(indices(i)) + firstRow;
+      std::copy(column, column + output.n_rows, output.colptr(i));
+    }
+  }
+
+  /**
+   * Copies the given columns of input into output. See GatherColumns() above.
+   *
+   * @param input Matrix whose columns are copied.
+   * @param indices Indices of columns that will be copied.
+   * @param output Matrix where the columns will be stored.
+   */
+  template<typename InputType, typename OutputType>
+  void GatherColumns(const InputType& input,
+                     const arma::uvec& indices,
+                     OutputType& output) const
+  {
+    if (input.n_rows == 0)
+      output.set_size(0, indices.n_elem);
+    else
+      GatherColumns(input, indices, 0, input.n_rows - 1, output);
+  }
+
+  /**
+   * Reorders the columns of dataset in place so that column i holds the
+   * column order(i). Each cycle of the permutation is followed with a single
+   * column of extra memory.
+   *
+   * @param dataset Matrix whose columns are reordered.
+   * @param order Permutation of column indices.
+   */
+  static void PermuteColumns(DatasetX& dataset, const arma::uvec& order)
+  {
+    std::vector<char> visited(order.n_elem, 0);
+    arma::Col<typename DatasetX::elem_type> temp(dataset.n_rows);
+    for (size_t start = 0; start < order.n_elem; start++)
+    {
+      if (visited[start] || order(start) == start)
+        continue;
+
+      // Move each column of the cycle to its place, the first column is held
+      // in temp until the cycle is closed.
+      std::copy(dataset.colptr(start), dataset.colptr(start) + dataset.n_rows,
+          temp.memptr());
+      size_t current = start;
+      while (order(current) != start)
+      {
+        const size_t next = order(current);
+        std::copy(dataset.colptr(next), dataset.colptr(next) + dataset.n_rows,
+            dataset.colptr(current));
+        visited[current] = 1;
+        current = next;
+      }
+
+      std::copy(temp.memptr(), temp.memptr() + dataset.n_rows,
+          dataset.colptr(current));
+      visited[current] = 1;
+    }
+  }
+
+  /**
+   * Splits a dataset into the training and validation sets of the
+   * DataLoader. Only one permutation of column indices is created and
+   * features are copied straight into their final matrices.
+   *
+   * @param dataset Features of the dataset.
+   * @param labels Labels of the dataset.
+   * @param validRatio Ratio of dataset to be used for validation set.
+   * @param shuffle Boolean to determine whether or not to shuffle the data.
+   * @param inPlace If true, the columns of dataset are permuted in place,
+   *     the validation columns are copied out and dataset is shrunk to the
+   *     training columns without reallocating, see ShrinkColumns(). It's
+   *     moved into the training features, so dataset is empty afterwards.
+   *     Otherwise dataset isn't modified.
+   */
+  void SplitDataset(DatasetX& dataset,
+                    const DatasetY& labels,
+                    const double validRatio,
+                    const bool shuffle,
+                    const bool inPlace)
+  {
+    const size_t validSize = static_cast<size_t>(dataset.n_cols * validRatio);
+    const size_t trainSize = dataset.n_cols - validSize;
+
+    const arma::uvec order = SplitOrder(dataset.n_cols, shuffle);
+    GatherLabels(labels, order.head(trainSize), trainLabels);
+    GatherLabels(labels, order.tail(validSize), validLabels);
+
+    if (!inPlace)
+    {
+      GatherColumns(dataset, order.head(trainSize), trainFeatures);
+      GatherColumns(dataset, order.tail(validSize), validFeatures);
+      return;
+    }
+
+    PermuteColumns(dataset, order);
+    if (validSize > 0)
+      validFeatures = dataset.cols(trainSize, dataset.n_cols - 1);
+    else
+      validFeatures.set_size(dataset.n_rows, 0);
+
+    // Training features are the leading columns, so the dataset keeps its
+    // memory and only its size changes.
+    ShrinkColumns(dataset, trainSize);
+    trainFeatures = std::move(dataset);
+  }
+
+  /**
+   * Shrinks a matrix to its leading columns. Armadillo keeps the memory, and
+   * so the elements, of a matrix whose new size is more than half of its
+   * allocation and doesn't fit its local buffer, so set_size() doesn't copy
+   * the columns that are kept. Otherwise the trailing columns are shed, which
+   * copies the matrix.
+   *
+   * @param dataset Matrix that will be shrunk.
+   * @param cols Number of leading columns that are kept.
+   */
+  static void ShrinkColumns(DatasetX& dataset, const size_t cols)
+  {
+    if (cols >= dataset.n_cols)
+      return;
+
+    const size_t elems = dataset.n_rows * cols;
+    if (dataset.mem_state == 0 && elems > arma::arma_config::mat_prealloc &&
+        2 * elems > dataset.n_alloc)
+    {
+      const typename DatasetX::elem_type* memory = dataset.memptr();
+      dataset.set_size(dataset.n_rows, cols);
+      mlpack::Log::Assert(dataset.memptr() == memory,
+          "Shrinking the dataset moved its memory.");
+    }
+    else
+    {
+      dataset.shed_cols(cols, dataset.n_cols - 1);
+    }
+  }
+
+  /**
+   * Splits lazily loaded images and their labels into training and
+   * validation sets.
+   *
+   * @param images Lazily loaded images.
+   * @param labels Labels of the images, one column per image.
+   * @param validRatio Ratio of dataset to be used for validation set.
+   * @param shuffle Boolean to determine whether or not to shuffle the data.
+   */
+  void LazyTrainTestSplit(const LazyDataset<DatasetX>& images,
+                          const DatasetY& labels,
+                          const double validRatio,
+                          const bool shuffle)
+  {
+    const size_t validSize = static_cast<size_t>(images.Size() * validRatio);
+    const size_t trainSize = images.Size() - validSize;
+
+    const arma::uvec order = SplitOrder(images.Size(), shuffle);
+    const arma::uvec trainOrder = order.head(trainSize);
+    const arma::uvec validOrder = order.tail(validSize);
+
+    trainImages = images.Subset(trainOrder);
+    validImages = images.Subset(validOrder);
+
+    GatherLabels(labels, trainOrder, trainLabels);
+    GatherLabels(labels, validOrder, validLabels);
+
+    // Features are decoded when a batch is requested.
+    trainFeatures.reset();
+    validFeatures.reset();
+  }
+
+  /**
+   * Augments the training set, or stores the augmentations so that they are
+   * applied to training batches if AugmentBatches() is set or the training
+   * set was loaded lazily.
+   *
+   * @param augmentations Augmentations that haven't been applied yet.
+   * @param augmentationProbability Probability of applying augmentation to
+   *     an image.
+   * @param width Width of training images.
+   * @param height Height of training images.
+   * @param depth Depth of training images.
+   */
+  void AugmentTrainSet(const std::vector<std::string>& augmentations,
+                       const double augmentationProbability,
+                       const size_t width,
+                       const size_t height,
+                       const size_t depth)
+  {
+    batchDetectionAugmentation = DetectionAugmentation();
+    batchAugmentation = AugmentationPipeline(augmentations,
+        augmentationProbability, width, height, depth);
+    if (!augmentBatches && trainImages.Size() == 0)
+    {
+      batchAugmentation.Apply(trainFeatures, mlpack::math::RandInt(1 << 30),
+          arma::uvec(), numThreads);
+      batchAugmentation = AugmentationPipeline();
+    }
+  }
+
+  /**
+   * Augments the training set of an object detection dataset, or stores the
+   * augmentations so that they are applied to training batches. Geometric
+   * augmentations supported by DetectionAugmentation are applied to images
+   * and their bounding boxes together, after the other augmentations.
+   *
+   * @param augmentations Augmentations that haven't been applied yet.
+   * @param augmentationProbability Probability of applying augmentation to
+   *     an image.
+   * @param width Width of training images.
+   * @param height Height of training images.
+   * @param depth Depth of training images.
+   */
+  void AugmentDetectionTrainSet(const std::vector<std::string>& augmentations,
+                                const double augmentationProbability,
+                                const size_t width,
+                                const size_t height,
+                                const size_t depth)
+  {
+    std::vector<std::string> imageAugmentations, boxAugmentations;
+    for (const std::string& augmentation : augmentations)
+    {
+      if (DetectionAugmentation::Supports(augmentation))
+        boxAugmentations.push_back(augmentation);
+      else
+        imageAugmentations.push_back(augmentation);
+    }
+
+    AugmentTrainSet(imageAugmentations, augmentationProbability, width,
+        height, depth);
+
+    batchDetectionAugmentation = DetectionAugmentation(boxAugmentations,
+        augmentationProbability, width, height, depth);
+    if (!augmentBatches && trainImages.Size() == 0)
+    {
+      batchDetectionAugmentation.Apply(trainFeatures, trainLabels,
+          mlpack::math::RandInt(1 << 30), arma::uvec(), numThreads);
+      batchDetectionAugmentation = DetectionAugmentation();
+    }
+  }
+
+  /**
+   * Get all augmentations except resize.
+   *
+   * @param augmentations Augmentations passed to the load function.
+   */
+  static std::vector<std::string> RemoveResizeParam(
+      Augmentation& augmentations)
+  {
+    std::vector<std::string> remaining;
+    for (const std::string& augmentation : augmentations.augmentations)
+    {
+      if (!augmentations.HasResizeParam(augmentation))
+        remaining.push_back(augmentation);
+    }
+
+    return remaining;
+  }
+
+  /**
+   * Converts labels of an object detection dataset to a field.
+   *
+   * @param labels Bounding boxes of each image.
+   * @param output Field where each element holds bounding boxes of an image.
+   */
+  static void DequeToLabels(const std::deque<arma::vec>& labels,
+                            arma::field<arma::vec>& output)
+  {
+    output.set_size(1, labels.size());
+    for (size_t i = 0; i < labels.size(); i++)
+      output(0, i) = labels[i];
+  }
+
+  /**
+   * Converts labels of an object detection dataset to a matrix. Each image
+   * must have the same number of objects.
+   *
+   * @param labels Bounding boxes of each image.
+   * @param output Matrix where each column holds bounding boxes of an image.
+   */
+  static void DequeToLabels(const std::deque<arma::vec>& labels,
+                            arma::mat& output)
+  {
+    output.set_size(labels.size() > 0 ? labels[0].n_rows : 0, labels.size());
+    for (size_t i = 0; i < labels.size(); i++)
+      output.col(i) = labels[i];
+  }
+
+  /**
+   * Fits the scaler on the training features, unless FitScaler() is false,
+   * and scales the training and validation features.
+   */
+  void ScaleFeatures(std::true_type /* doubleFeatures */)
+  {
+    if (fitScaler)
+    {
+      if (worldSize > 1)
+      {
+        mlpack::Log::Warn << "The scaler is fitted on the shard of rank "
+            << rank << " only. Set FitScaler() to false to use a scaler "
+            << "fitted on the whole dataset." << std::endl;
+      }
+
+      scaler.Fit(trainFeatures);
+    }
+
+    scaler.Transform(trainFeatures, trainFeatures);
+    scaler.Transform(validFeatures, validFeatures);
+  }
+
+  /**
+   * Scalers only support features of type double, so compact features such
+   * as 8-bit images are kept as they are.
+   */
+  void ScaleFeatures(std::false_type /* doubleFeatures */)
+  {
+    mlpack::Log::Warn << "Features aren't scaled as they aren't of type "
+        << "double. Use PreProcessor::ConvertImages() to scale batches."
+        << std::endl;
+  }
+
+  //! Scales the test features with the scaler fitted on training features.
+  void ScaleTestFeatures(std::true_type /* doubleFeatures */)
+  {
+    scaler.Transform(testFeatures, testFeatures);
+  }
+
+  //! Features that aren't of type double aren't scaled.
+  void ScaleTestFeatures(std::false_type /* doubleFeatures */)
+  {
+    ScaleFeatures(std::false_type());
+  }
+
   /**
    * Utility Function to wrap indices.
    *
@@ -373,10 +1253,9 @@ class DataLoader
   /**
    * Performs train test split.
    *
-   * @tparam DatasetType Type of input dataset.
-   * @tparam LabelsType Type of input labels.
-   *
-   * @param dataset Features of dataset.
+   * @param dataset Features of dataset. Its memory is reused for training
+   *     features unless most of it is used for validation, and it's empty
+   *     afterwards.
    * @param labels Labels of the dataset.
    * @param validRatio Ratio for train-test split.
    * @param shuffle Boolean to determine shuffling of dataset.
@@ -390,43 +1269,17 @@ class DataLoader
                       const double validRatio,
                       const bool shuffle)
   {
-    const size_t validSize = static_cast<size_t>(dataset.n_cols * validRatio);
-    const size_t trainSize = dataset.n_cols - validSize;
-
-    arma::uvec order = arma::linspace<arma::uvec>(0, dataset.n_cols - 1,
-        dataset.n_cols);
-    if (shuffle)
-      order = arma::shuffle(order);
-
-    if (trainSize > 0)
-    {
-      trainLabels.set_size(1, trainSize);
-      trainFeatures = dataset.cols(order.subvec(0, trainSize - 1));
-
-      // Field type has fixed size so we can't use span and assignment
-      // operator.
-      for (size_t i = 0; i < trainSize; i++)
-        trainLabels(0, i) = labels[i];
-    }
-
-    if (validSize <= dataset.n_cols)
-    {
-      validFeatures = dataset.cols(order.subvec(trainSize,
-          dataset.n_cols - 1));
-      validLabels.set_size(1, validSize);
-      for (size_t i = trainSize; i < dataset.n_cols; i++)
-        validLabels(0, i - trainSize) = labels[i];
-    }
-    return;
+    arma::field<arma::vec> labelsTemp;
+    DequeToLabels(labels, labelsTemp);
+    SplitDataset(dataset, labelsTemp, validRatio, shuffle, true);
   }
 
   /**
    * Performs train/test split.
    *
-   * @tparam DatasetType Type of input dataset.
-   * @tparam LabelsType Type of input labels.
-   *
-   * @param dataset Features of dataset.
+   * @param dataset Features of dataset. Its memory is reused for training
+   *     features unless most of it is used for validation, and it's empty
+   *     afterwards.
    * @param labels Labels of the dataset.
    * @param validRatio Ratio for train-test split.
    * @param shuffle Boolean to determine shuffling of dataset.
@@ -440,29 +1293,9 @@ class DataLoader
                       const double validRatio,
                       const bool shuffle)
   {
-    // Calculate number of objects in the image.
-    size_t numberOfObjects = labels[0].n_rows;
-    DatasetY labelsTemp(numberOfObjects, labels.size());
-
-    for (size_t i = 0; i < labels.size(); i++)
-      labelsTemp.col(i) = labels[i];
-
-    DatasetX completeDataset = arma::join_cols(dataset, labelsTemp);
-    mlpack::data::Split(completeDataset, trainFeatures, validFeatures,
-        validRatio, shuffle);
-
-    // Features are all rows except the last 5 rows which correspond
-    // to bounding box.
-    trainLabels = trainFeatures.rows(trainFeatures.n_rows -
-        numberOfObjects, trainFeatures.n_rows - 1);
-    trainFeatures = trainFeatures.rows(0, trainFeatures.n_rows -
-        numberOfObjects - 1);
-
-    validLabels = validFeatures.rows(validFeatures.n_rows -
-        numberOfObjects, validFeatures.n_rows - 1);
-    validFeatures = validFeatures.rows(0, validFeatures.n_rows -
-        numberOfObjects - 1);
-    return;
+    arma::mat labelsTemp;
+    DequeToLabels(labels, labelsTemp);
+    SplitDataset(dataset, labelsTemp, validRatio, shuffle, true);
   }
 
   //! Locally stored mappings for some well known datasets.
@@ -495,11 +1328,49 @@ class DataLoader
   //! Locally stored ratio for train-test split.
   double ratio;
 
-  //! Locally stored augmentation.
-  std::vector<std::string> augmentation;
+  //! Locally stored augmentations applied to training batches.
+  AugmentationPipeline batchAugmentation;
+
+  //! Locally stored augmentations applied to images and bounding boxes of
+  //! training batches.
+  DetectionAugmentation batchDetectionAugmentation;
+
+  //! Locally stored boolean to determine whether training batches are
+  //! augmented instead of the training set.
+  bool augmentBatches;
+
+  //! Locally stored seed of augmentations applied to training batches.
+  size_t augmentationSeed;
+
+  //! Locally stored number of threads used for loading data.
+  size_t numThreads;
+
+  //! Locally stored boolean to determine whether images are loaded lazily.
+  bool lazy;
+
+  //! Locally stored directory where decoded image datasets are cached.
+  std::string cachePath;
+
+  //! Locally stored index of the shard that is loaded.
+  size_t rank;
+
+  //! Locally stored number of shards.
+  size_t worldSize;
+
+  //! Locally stored seed of the permutation that assigns data points to
+  //! shards.
+  size_t shardSeed;
+
+  //! Locally stored boolean to determine whether the scaler is fitted on
+  //! training features.
+  bool fitScaler;
 
-  //! Locally stored augmentation probability.
-  double augmentationProbability;
+  //! Locally stored lazily loaded training images.
+  LazyDataset<DatasetX> trainImages;
+  //! Locally stored lazily loaded validation images.
+  LazyDataset<DatasetX> validImages;
+  //! Locally stored lazily loaded testing images.
+  LazyDataset<DatasetX> testImages;
 };
 
 } // namespace models
@@ -26,7 +26,15 @@ template<
   class ScalerType
 >DataLoader<
     DatasetX, DatasetY, ScalerType
->::DataLoader()
+>::DataLoader() :
+    augmentBatches(false),
+    augmentationSeed(0),
+    numThreads(0),
+    lazy(false),
+    rank(0),
+    worldSize(1),
+    shardSeed(0),
+    fitScaler(true)
 {
   // Nothing to do here.
 }
@@ -42,7 +50,17 @@ template<
               const double validRatio,
               const bool useScaler,
               const std::vector<std::string> augmentation,
-              const double augmentationProbability)
+              const double augmentationProbability,
+              const std::string& cachePath) :
+    augmentBatches(false),
+    augmentationSeed(0),
+    numThreads(0),
+    lazy(false),
+    cachePath(cachePath),
+    rank(0),
+    worldSize(1),
+    shardSeed(0),
+    fitScaler(true)
 {
   InitializeDatasets();
   if (datasetMap.count(dataset))
@@ -137,52 +155,69 @@ template<
            const std::vector<std::string> augmentation,
            const double augmentationProbability)
 {
-  arma::mat dataset;
-  data::Load(datasetPath, dataset, true);
-
-  if (loadTrainData)
+  // The file is parsed in parallel chunks, storing only the requested fields
+  // straight into the sets they belong to.
+  CSVReader reader;
+  if (!reader.Open(datasetPath, numThreads))
   {
-    arma::mat trainDataset, validDataset;
-    data::Split(dataset, trainDataset, validDataset, validRatio, shuffle);
+    mlpack::Log::Fatal << "Unable to open " << datasetPath << "." << std::endl;
+  }
 
-    trainFeatures = trainDataset.rows(WrapIndex(startInputFeatures,
-        trainDataset.n_rows), WrapIndex(endInputFeatures,
-        trainDataset.n_rows));
+  const size_t fields = reader.Cols();
+  const size_t startInput = WrapIndex(startInputFeatures, fields);
+  const size_t endInput = WrapIndex(endInputFeatures, fields);
 
-    trainLabels = trainDataset.rows(WrapIndex(startPredictionFeatures,
-        trainDataset.n_rows), WrapIndex(endPredictionFeatures,
-        trainDataset.n_rows));
+  // Lines outside of the shard of this DataLoader are skipped.
+  const arma::uvec shard = ShardIndices(reader.Rows());
+  arma::uvec columns(reader.Rows());
+  columns.fill(CSVReader::Skip());
+
+  if (loadTrainData)
+  {
+    const size_t validSize = static_cast<size_t>(shard.n_elem * validRatio);
+    const size_t trainSize = shard.n_elem - validSize;
 
-    validFeatures = validDataset.rows(WrapIndex(startInputFeatures,
-        validDataset.n_rows), WrapIndex(endInputFeatures,
-        validDataset.n_rows));
+    // Data point shard(order(i)) is stored in column i of the training set,
+    // or in column i - trainSize of the validation set.
+    const arma::uvec order = SplitOrder(shard.n_elem, shuffle);
+    for (size_t i = 0; i < order.n_elem; i++)
+      columns(shard(order(i))) = i;
 
-    validLabels = validDataset.rows(WrapIndex(startPredictionFeatures,
-        validDataset.n_rows), WrapIndex(endPredictionFeatures,
-        validDataset.n_rows));
+    reader.Read(columns, trainSize, startInput, endInput,
+        WrapIndex(startPredictionFeatures, fields),
+        WrapIndex(endPredictionFeatures, fields), trainFeatures, trainLabels,
+        validFeatures, validLabels, numThreads);
 
     if (useScaler)
     {
-      scaler.Fit(trainFeatures);
-      scaler.Transform(trainFeatures, trainFeatures);
-      scaler.Transform(validFeatures, validFeatures);
+      ScaleFeatures(std::is_same<typename DatasetX::elem_type, double>());
     }
 
+    trainImages = LazyDataset<DatasetX>();
+    validImages = LazyDataset<DatasetX>();
+
     Augmentation augmentations(augmentation, augmentationProbability);
-    augmentations.Transform(trainFeatures, 1, dataset.n_rows, 1);
+    AugmentTrainSet(augmentations.augmentations, augmentationProbability, 1,
+        trainFeatures.n_rows, 1);
 
     mlpack::Log::Info << "Training Dataset Loaded." << std::endl;
   }
   else
   {
+    for (size_t i = 0; i < shard.n_elem; i++)
+      columns(shard(i)) = i;
+
+    DatasetX unusedFeatures;
+    arma::mat unusedLabels, unusedValidLabels;
+    reader.Read(columns, shard.n_elem, startInput, endInput, 1, 0,
+        testFeatures, unusedLabels, unusedFeatures, unusedValidLabels,
+        numThreads);
+
     if (useScaler)
     {
-      scaler.Transform(dataset, dataset);
+      ScaleTestFeatures(std::is_same<typename DatasetX::elem_type, double>());
     }
 
-    testFeatures = dataset.rows(WrapIndex(startInputFeatures, dataset.n_rows),
-        WrapIndex(endInputFeatures, dataset.n_rows));
-
     mlpack::Log::Info << "Testing Dataset Loaded." << std::endl;
   }
 }
@@ -216,145 +251,212 @@ template<
 
   std::vector<boost::filesystem::path> annotationsDirectory;
 
-  DatasetX dataset;
-  std::deque<arma::vec> labels;
-
   // Fill the directory.
   Utils::ListDir(pathToAnnotations, annotationsDirectory, absolutePath);
 
-  // Create a map for labels and corresponding class name.
-  // This provides faster access to class labels.
-  std::unordered_map<std::string, size_t> classMap;
-  for (size_t i = 0; i < classes.size(); i++)
-    classMap.insert(std::make_pair(classes[i], i));
-
-  // Map to insert values in a column vector.
-  std::unordered_map<std::string, size_t> indexMap;
-  indexMap.insert(std::make_pair(classNameXMLTag, 0));
-  indexMap.insert(std::make_pair(x1XMLTag, 1));
-  indexMap.insert(std::make_pair(y1XMLTag, 2));
-  indexMap.insert(std::make_pair(x2XMLTag, 3));
-  indexMap.insert(std::make_pair(y2XMLTag, 4));
-
-  // Keep track of files loaded.
-  size_t totalFiles = annotationsDirectory.size(), loadedFiles = 0;
-  size_t imageWidth = 0, imageHeight = 0, imageDepth = 0;
+  std::vector<std::string> annotationPaths;
+  for (const boost::filesystem::path& annotationFile : annotationsDirectory)
+  {
+    const std::string path = annotationFile.string();
+    if (path.length() > 3 && path.substr(path.length() - 3) == "xml")
+      annotationPaths.push_back(path);
+  }
 
-  // Read the XML file.
-  for (boost::filesystem::path annotationFile : annotationsDirectory)
+  // Only annotations in the shard of this DataLoader are parsed.
+  KeepShard(annotationPaths);
+
+  // Tag and class names are mapped once, so that each annotation file is
+  // parsed in a single pass.
+  const AnnotationParser parser(classes, baseXMLTag, imageNameXMLTag,
+      sizeXMLTag, objectXMLTag, bndboxXMLTag, classNameXMLTag, x1XMLTag,
+      y1XMLTag, x2XMLTag, y2XMLTag);
+
+  const size_t totalFiles = annotationPaths.size();
+  std::vector<Annotation> annotations(totalFiles);
+  std::vector<char> parsed(totalFiles, 0);
+
+  // Parse the XML files in parallel. Boxes of each chunk of files are
+  // appended to one flat buffer, boxes of file i are in buffer i / chunkSize.
+  const size_t chunkSize = 64;
+  std::vector<std::vector<double>> boxBuffers((totalFiles + chunkSize - 1) /
+      chunkSize);
+
+  #pragma omp parallel for num_threads(Utils::NumThreads(numThreads)) \
+      schedule(dynamic)
+  for (omp_size_t chunk = 0; chunk < (omp_size_t) boxBuffers.size(); chunk++)
   {
-    if (annotationFile.string().length() <= 3 ||
-        annotationFile.string().substr(
-        annotationFile.string().length() - 3) != "xml")
+    std::vector<double>& boxes = boxBuffers[chunk];
+    const size_t last = std::min(((size_t) chunk + 1) * chunkSize,
+        totalFiles);
+    for (size_t i = (size_t) chunk * chunkSize; i < last; i++)
     {
-      continue;
+      if (!parser.Parse(annotationPaths[i], annotations[i], boxes))
+      {
+        #pragma omp critical
+        mlpack::Log::Warn << "Unable to parse " << annotationPaths[i] << "."
+            << std::endl;
+        continue;
+      }
+
+      // If image doesn't exist then skip the current XML file.
+      if (!Utils::PathExists(pathToImages + annotations[i].imageName,
+          absolutePath))
+      {
+        #pragma omp critical
+        mlpack::Log::Warn << "Image not found! Tried finding " <<
+            pathToImages + annotations[i].imageName << std::endl;
+        continue;
+      }
+
+      parsed[i] = 1;
     }
+  }
 
-    loadedFiles++;
-    Log::Info << "Files Loaded : " << loadedFiles << " out of " <<
-        totalFiles << "\r" << std::endl;
+  // Get the boxes of the annotation of file i.
+  auto boxesOf = [&](const size_t i) -> double*
+  {
+    return boxBuffers[i / chunkSize].data() + annotations[i].boxOffset;
+  };
 
-    // Read the XML file.
-    boost::property_tree::ptree xmlFile;
-    boost::property_tree::read_xml(annotationFile.string(), xmlFile);
+  // Images of annotations that were parsed.
+  std::vector<size_t> files;
+  for (size_t i = 0; i < totalFiles; i++)
+  {
+    if (parsed[i])
+      files.push_back(i);
+  }
 
-    // Get annotation from XML file.
-    boost::property_tree::ptree annotation = xmlFile.get_child(baseXMLTag);
+  mlpack::Log::Info << "Parsed " << files.size() << " out of " << totalFiles
+      << " annotation files." << std::endl;
 
-    // Read properties inside annotation file.
-    // Get image name.
-    std::string imgName = annotation.get_child(imageNameXMLTag).data();
+  size_t imageWidth = 0, imageHeight = 0, imageDepth = 0;
+  for (const size_t i : files)
+  {
+    // Scale bounding boxes to the size of the resized image. A letterbox
+    // resize also shifts them by the padding.
+    const BilinearResize resize = augmentation.GetResize(annotations[i].width,
+        annotations[i].height, annotations[i].depth,
+        augmentation.HasResizeParam() ? augmentation.augmentations[0] : "");
+    double* boxes = boxesOf(i);
+    for (size_t j = 0; j < 5 * annotations[i].numBoxes; j += 5)
+    {
+      boxes[j + 1] = std::floor(resize.ToOutputX(boxes[j + 1]));
+      boxes[j + 2] = std::floor(resize.ToOutputY(boxes[j + 2]));
+      boxes[j + 3] = std::floor(resize.ToOutputX(boxes[j + 3]));
+      boxes[j + 4] = std::floor(resize.ToOutputY(boxes[j + 4]));
+    }
 
-    // If image doesn't exist then skip the current XML file.
-    if (!Utils::PathExists(pathToImages + imgName, absolutePath))
+    imageWidth = resize.OutputWidth();
+    imageHeight = resize.OutputHeight();
+    imageDepth = annotations[i].depth;
+  }
+
+  // Images and labels are stored in the reverse order of the annotation
+  // files.
+  std::deque<arma::vec> labels;
+  if (lazy)
+  {
+    // The images are decoded and resized when a batch is requested.
+    LazyDataset<DatasetX> images;
+    images.ImageWidth() = imageWidth;
+    images.ImageHeight() = imageHeight;
+    images.ImageDepth() = imageDepth;
+    if (augmentation.HasResizeParam())
+      images.ResizeParam() = augmentation.augmentations[0];
+
+    for (std::vector<size_t>::reverse_iterator it = files.rbegin();
+        it != files.rend(); ++it)
     {
-      mlpack::Log::Warn << "Image not found! Tried finding " <<
-          pathToImages + imgName << std::endl;
-      continue;
+      const Annotation& annotation = annotations[*it];
+      images.Add(pathToImages + annotation.imageName, annotation.width,
+          annotation.height, annotation.depth);
+      labels.push_back(arma::vec(boxesOf(*it), 5 * annotation.numBoxes));
     }
 
-    // Get the size of image to create image info required
-    // by mlpack::data::Load function.
-    boost::property_tree::ptree sizeInfo = annotation.get_child(sizeXMLTag);
-    imageWidth = std::stoi(sizeInfo.get_child("width").data());
-    imageHeight = std::stoi(sizeInfo.get_child("height").data());
-    imageDepth = std::stoi(sizeInfo.get_child("depth").data());
-    mlpack::data::ImageInfo imageInfo(imageWidth, imageHeight, imageDepth);
+    DatasetY labelsTemp;
+    DequeToLabels(labels, labelsTemp);
+    LazyTrainTestSplit(images, labelsTemp, validRatio, shuffle);
+    AugmentDetectionTrainSet(RemoveResizeParam(augmentation),
+        augmentationProbability, imageWidth, imageHeight, imageDepth);
+    return;
+  }
+
+  // Allocate space for all images once. Image of files[i] is stored in
+  // column (files.size() - 1 - i). The shape of the last image sets the shape
+  // of the dataset.
+  const size_t imageSize = files.empty() ? 0 :
+      imageWidth * imageHeight * imageDepth;
+  DatasetX dataset(imageSize, files.size());
+  std::vector<char> loaded(files.size(), 0);
+
+  #pragma omp parallel for num_threads(Utils::NumThreads(numThreads)) \
+      schedule(dynamic)
+  for (omp_size_t i = 0; i < (omp_size_t) files.size(); i++)
+  {
+    const Annotation& annotation = annotations[files[i]];
 
     // Load the image.
     // The image loaded here will be in column format i.e. Output will
     // be matrix with the following shape {1, cols * rows * slices} in
     // column major format.
+    mlpack::data::ImageInfo imageInfo(annotation.width, annotation.height,
+        annotation.depth);
     DatasetX image;
-    mlpack::data::Load(pathToImages + imgName, image, imageInfo);
+    if (!mlpack::data::Load(pathToImages + annotation.imageName, image,
+        imageInfo))
+    {
+      continue;
+    }
 
-    double horizontalScale = 1.0, verticalScale = 1.0;
+    // Images are already resized in parallel, so each one uses one thread.
     if (augmentation.HasResizeParam())
     {
-      augmentation.ResizeTransform(image, imageWidth, imageHeight, imageDepth,
-          augmentation.augmentations[0]);
-
-      size_t outputWidth = 0, outputHeight = 0;
-      augmentation.GetResizeParam(outputWidth, outputHeight,
-          augmentation.augmentations[0]);
-      horizontalScale = 1.0 * outputWidth / imageWidth;
-      verticalScale = 1.0 * outputHeight / imageHeight;
-      imageWidth = outputWidth;
-      imageHeight = outputHeight;
+      augmentation.ResizeTransform(image, annotation.width, annotation.height,
+          annotation.depth, augmentation.augmentations[0], 1);
     }
 
-    // Iterate over all object in annotation.
-    arma::vec boundingBoxes;
-    BOOST_FOREACH(boost::property_tree::ptree::value_type const& object,
-        annotation)
+    if (image.n_rows != imageSize)
     {
-      arma::vec predictions(5);
-      // Iterate over property of the object to get class label and
-      // bounding box coordinates.
-      if (object.first == objectXMLTag)
-      {
-        if (classMap.count(object.second.get_child(classNameXMLTag).data()))
-        {
-          predictions(indexMap[classNameXMLTag]) = classMap[
-              object.second.get_child(classNameXMLTag).data()];
-          boost::property_tree::ptree const &boundingBox =
-              object.second.get_child(bndboxXMLTag);
-
-          BOOST_FOREACH(boost::property_tree::ptree::value_type
-              const& coordinate, boundingBox)
-          {
-            if (indexMap.count(coordinate.first))
-            {
-              predictions(indexMap[coordinate.first]) =
-                  std::stoi(coordinate.second.data());
-            }
-          }
-
-          // Scale predictions.
-          predictions(indexMap[x1XMLTag]) = std::floor(
-              predictions(indexMap[x1XMLTag]) * horizontalScale);
-          predictions(indexMap[x2XMLTag]) = std::floor(
-              predictions(indexMap[x2XMLTag]) * horizontalScale);
-          predictions(indexMap[y1XMLTag]) = std::floor(
-              predictions(indexMap[y1XMLTag]) * verticalScale);
-          predictions(indexMap[y2XMLTag]) = std::floor(
-              predictions(indexMap[y2XMLTag]) * verticalScale);
-          boundingBoxes.insert_rows(0, predictions);
-        }
-      }
+      #pragma omp critical
+      mlpack::Log::Warn << "Skipping " << annotation.imageName << " as its "
+          << "shape doesn't match the shape of the dataset." << std::endl;
+      continue;
     }
 
-    // Add object to training set.
-    dataset.insert_cols(0, image);
-    labels.push_front(boundingBoxes);
+    dataset.col(files.size() - 1 - i) = image;
+    loaded[i] = 1;
+  }
+
+  // Remove columns of images that couldn't be loaded while preserving the
+  // order of the remaining ones.
+  size_t loadedImages = 0;
+  for (size_t col = 0; col < dataset.n_cols; col++)
+  {
+    const size_t i = files.size() - 1 - col;
+    if (!loaded[i])
+      continue;
+
+    if (col != loadedImages)
+      dataset.col(loadedImages) = dataset.col(col);
+
+    labels.push_back(arma::vec(boxesOf(files[i]), 5 *
+        annotations[files[i]].numBoxes));
+    loadedImages++;
   }
 
+  if (loadedImages < dataset.n_cols)
+    dataset.shed_cols(loadedImages, dataset.n_cols - 1);
+
   TrainTestSplit(dataset, labels, this->trainFeatures, this->trainLabels,
       this->validFeatures, this->validLabels, validRatio, shuffle);
-
-  // Augment the training data.
-  augmentation.Transform(this->trainFeatures, imageWidth, imageHeight,
-      imageDepth);
+  trainImages = LazyDataset<DatasetX>();
+  validImages = LazyDataset<DatasetX>();
+
+  // Augment the training data. Images were resized above, so only the
+  // remaining augmentations are applied. Geometric augmentations move the
+  // bounding boxes with the images.
+  AugmentDetectionTrainSet(RemoveResizeParam(augmentation),
+      augmentationProbability, imageWidth, imageHeight, imageDepth);
 }
 
 template<
@@ -370,6 +472,51 @@ template<
                               const size_t imageHeight,
                               const size_t imageDepth,
                               const size_t label)
+{
+  std::vector<std::string> imagePaths;
+  std::vector<size_t> imageLabels;
+  ListImages(imagesPath, imagePaths, imageLabels, label);
+  KeepShard(imagePaths);
+  KeepShard(imageLabels);
+
+  // Images are appended to a non-empty dataset, so only empty datasets are
+  // cached.
+  if (cachePath.empty() || dataset.n_elem > 0)
+  {
+    LoadImages(imagePaths, imageLabels, dataset, labels, imageWidth,
+        imageHeight, imageDepth);
+    return;
+  }
+
+  const std::string cacheKey = DatasetCache<DatasetX, DatasetY>::Key(
+      imagePaths, imageLabels, imageWidth, imageHeight, imageDepth, "");
+  DatasetCache<DatasetX, DatasetY> cache;
+  if (cache.Load(cachePath, cacheKey))
+  {
+    dataset = cache.Features();
+    labels = cache.Labels();
+    return;
+  }
+
+  LoadImages(imagePaths, imageLabels, dataset, labels, imageWidth,
+      imageHeight, imageDepth);
+  if (dataset.n_elem > 0)
+  {
+    DatasetCache<DatasetX, DatasetY>::Save(cachePath, cacheKey, dataset,
+        labels);
+  }
+}
+
+template<
+  typename DatasetX,
+  typename DatasetY,
+  class ScalerType
+> void DataLoader<
+    DatasetX, DatasetY, ScalerType
+>::ListImages(const std::string& imagesPath,
+              std::vector<std::string>& imagePaths,
+              std::vector<size_t>& imageLabels,
+              const size_t label)
 {
   // Get all files in given directory.
   std::vector<boost::filesystem::path> imagesDirectory;
@@ -378,12 +525,9 @@ template<
   std::set<std::string> supportedExtentions = {".jpg", ".png", ".tga",
       ".bmp", ".psd", ".gif", ".hdr", ".pic", ".pnm"};
 
-  // We use to endls here as one of them will be replaced by print
-  // command below.
   mlpack::Log::Info << "Found " << imagesDirectory.size() << " belonging to " <<
-      label << " class." << std::endl << std::endl;
+      label << " class." << std::endl;
 
-  size_t loadedImages = 0;
   for (boost::filesystem::path imageName : imagesDirectory)
   {
     if (imageName.string().length() <= 3 ||
@@ -392,24 +536,119 @@ template<
     {
       continue;
     }
-    mlpack::data::ImageInfo imageInfo(imageWidth, imageHeight, imageDepth);
 
+    imagePaths.push_back(imageName.string());
+    imageLabels.push_back(label);
+  }
+}
+
+template<
+  typename DatasetX,
+  typename DatasetY,
+  class ScalerType
+> void DataLoader<
+    DatasetX, DatasetY, ScalerType
+>::LoadImages(const std::vector<std::string>& imagePaths,
+              const std::vector<size_t>& imageLabels,
+              DatasetX& dataset,
+              DatasetY& labels,
+              const size_t imageWidth,
+              const size_t imageHeight,
+              const size_t imageDepth)
+{
+  const size_t totalImages = imagePaths.size();
+
+  // Every image must have the same size as the existing dataset. If the
+  // dataset is empty, the first image that can be decoded sets the size.
+  size_t firstImage = 0;
+  DatasetX image;
+  if (dataset.n_elem == 0)
+  {
+    for (; firstImage < totalImages; firstImage++)
+    {
+      mlpack::data::ImageInfo imageInfo(imageWidth, imageHeight, imageDepth);
+      if (mlpack::data::Load(imagePaths[firstImage], image, imageInfo) &&
+          image.n_elem > 0)
+      {
+        break;
+      }
+    }
+
+    if (firstImage == totalImages)
+      return;
+  }
+
+  const size_t imageSize = dataset.n_elem == 0 ? image.n_rows : dataset.n_rows;
+
+  // Allocate space for all images once. Image i is stored in column
+  // (totalImages - 1 - i), so that the first image ends up in the last column.
+  DatasetX images(imageSize, totalImages - firstImage);
+  std::vector<char> loaded(totalImages, 0);
+  if (dataset.n_elem == 0)
+  {
+    images.col(totalImages - 1 - firstImage) = image;
+    loaded[firstImage] = 1;
+  }
+
+  // The image decoded above doesn't need to be decoded again.
+  const size_t startImage = dataset.n_elem == 0 ? firstImage + 1 : firstImage;
+
+  #pragma omp parallel for num_threads(Utils::NumThreads(numThreads)) \
+      schedule(dynamic)
+  for (omp_size_t i = startImage; i < (omp_size_t) totalImages; i++)
+  {
     // Load the image.
     // The image loaded here will be in column format i.e. Output will
     // be matrix with the following shape {1, cols * rows * slices} in
     // column major format.
-    DatasetX image;
-    mlpack::data::Load(imageName.string(), image, imageInfo);
-
-    // Add object to training set.
-    if (image.n_rows == dataset.n_rows || dataset.n_elem == 0)
+    mlpack::data::ImageInfo imageInfo(imageWidth, imageHeight, imageDepth);
+    DatasetX currentImage;
+    if (!mlpack::data::Load(imagePaths[i], currentImage, imageInfo) ||
+        currentImage.n_rows != imageSize)
     {
-      labels.insert_cols(0, arma::vec(1).fill(label));
-      dataset.insert_cols(0, image);
-      loadedImages++;
-      mlpack::Log::Info << "Loaded " << loadedImages << " out of " <<
-          imagesDirectory.size() << "\r" << std::endl;
+      continue;
     }
+
+    images.col(totalImages - 1 - i) = currentImage;
+    loaded[i] = 1;
+  }
+
+  // Remove columns of images that couldn't be loaded while preserving the
+  // order of the remaining ones.
+  DatasetY imagesLabels(1, images.n_cols);
+  size_t loadedImages = 0;
+  for (size_t col = 0; col < images.n_cols; col++)
+  {
+    const size_t i = totalImages - 1 - col;
+    if (!loaded[i])
+      continue;
+
+    if (col != loadedImages)
+      images.col(loadedImages) = images.col(col);
+
+    imagesLabels(0, loadedImages) = imageLabels[i];
+    loadedImages++;
+  }
+
+  if (loadedImages < images.n_cols)
+  {
+    images.shed_cols(loadedImages, images.n_cols - 1);
+    imagesLabels.shed_cols(loadedImages, imagesLabels.n_cols - 1);
+  }
+
+  mlpack::Log::Info << "Loaded " << loadedImages << " out of " <<
+      totalImages << " images." << std::endl;
+
+  // Add images to the dataset.
+  if (dataset.n_elem == 0)
+  {
+    dataset = std::move(images);
+    labels = std::move(imagesLabels);
+  }
+  else
+  {
+    dataset = arma::join_rows(images, dataset);
+    labels = arma::join_rows(imagesLabels, labels);
   }
 }
 
@@ -437,53 +676,128 @@ template<
   std::vector<boost::filesystem::path> classes;
   Utils::ListDir(pathToDataset, classes);
 
-  DatasetX dataset;
-  DatasetY labels;
+  // Collect images of all classes so that they are decoded at once.
+  std::vector<std::string> imagePaths;
+  std::vector<size_t> imageLabels;
 
   // Iterate the directory.
   for (boost::filesystem::path className : classes)
   {
     if (boost::filesystem::is_directory(className))
     {
-      LoadAllImagesFromDirectory(className.string() +
-        "/", dataset, labels, imageWidth, imageHeight, imageDepth,
-        totalClasses);
+      ListImages(className.string() + "/", imagePaths, imageLabels,
+          totalClasses);
       classMap[className.string()] = totalClasses;
       totalClasses++;
     }
   }
 
-  if (!trainData)
+  // Only images in the shard of this DataLoader are decoded. The shard is
+  // then split into training and validation sets.
+  KeepShard(imagePaths);
+  KeepShard(imageLabels);
+
+  size_t outputWidth = imageWidth, outputHeight = imageHeight;
+  if (augmentations.HasResizeParam())
   {
-    testFeatures = std::move(dataset);
-    testLabels = std::move(labels);
+    augmentations.GetResizeParam(outputWidth, outputHeight,
+        augmentations.augmentations[0]);
+  }
 
-    // Only resize augmentation will be applied on test set.
-    if (augmentations.HasResizeParam())
+  if (lazy)
+  {
+    // Only paths of images are stored, images are decoded and resized when
+    // a batch is requested. Images are stored in the same order as eagerly
+    // loaded images.
+    LazyDataset<DatasetX> images(outputWidth, outputHeight, imageDepth);
+    DatasetY labels(1, imagePaths.size());
+    for (size_t i = 0; i < imagePaths.size(); i++)
     {
-      augmentations.ResizeTransform(testFeatures, imageWidth, imageHeight,
-          imageDepth, augmentations.augmentations[0]);
+      const size_t imageIndex = imagePaths.size() - 1 - i;
+      images.Add(imagePaths[imageIndex], imageWidth, imageHeight, imageDepth);
+      labels(0, i) = imageLabels[imageIndex];
     }
 
-    return;
+    if (!trainData)
+    {
+      testImages = std::move(images);
+      testLabels = std::move(labels);
+      testFeatures.reset();
+      return;
+    }
+
+    LazyTrainTestSplit(images, labels, validRatio, shuffle);
+    AugmentTrainSet(RemoveResizeParam(augmentations), augmentationProbability,
+        outputWidth, outputHeight, imageDepth);
   }
+  else
+  {
+    // Images are resized before they are cached, so that a cached dataset is
+    // used as is.
+    const std::string resizeParam = augmentations.HasResizeParam() ?
+        augmentations.augmentations[0] : "";
+    const std::string cacheKey = cachePath.empty() ? "" :
+        DatasetCache<DatasetX, DatasetY>::Key(imagePaths, imageLabels,
+        imageWidth, imageHeight, imageDepth, resizeParam);
+
+    // A cached dataset aliases the mapped cache file, which stays mapped
+    // until the dataset is split.
+    DatasetCache<DatasetX, DatasetY> cache;
+    DatasetX decodedDataset;
+    DatasetY decodedLabels;
+    const bool cached = !cachePath.empty() && cache.Load(cachePath, cacheKey);
+    if (!cached)
+    {
+      LoadImages(imagePaths, imageLabels, decodedDataset, decodedLabels,
+          imageWidth, imageHeight, imageDepth);
 
-  // Train-validation data split.
-  arma::mat completeDataset = arma::join_cols(dataset, labels);
-  arma::mat trainingData, validationData;
-  mlpack::data::Split(completeDataset, trainingData, validationData,
-      validRatio, shuffle);
+      if (augmentations.HasResizeParam())
+      {
+        augmentations.ResizeTransform(decodedDataset, imageWidth, imageHeight,
+            imageDepth, resizeParam, numThreads);
+      }
 
-  trainFeatures = trainingData.rows(0, trainingData.n_rows - 2);
-  trainLabels = trainingData.rows(trainingData.n_rows - 1,
-      trainingData.n_rows - 1);
+      if (!cachePath.empty() && decodedDataset.n_elem > 0)
+      {
+        DatasetCache<DatasetX, DatasetY>::Save(cachePath, cacheKey,
+            decodedDataset, decodedLabels);
+      }
+    }
 
-  validFeatures = validationData.rows(0, validationData.n_rows - 2);
-  validLabels = validationData.rows(validationData.n_rows - 1,
-      validationData.n_rows - 1);
+    DatasetX& dataset = cached ? cache.Features() : decodedDataset;
+    DatasetY& labels = cached ? cache.Labels() : decodedLabels;
 
-  augmentations.Transform(trainFeatures, imageWidth, imageHeight, imageDepth);
-  augmentations.Transform(validFeatures, imageWidth, imageHeight, imageDepth);
+    if (!trainData)
+    {
+      // A cached dataset aliases the mapped file, which is closed when the
+      // cache goes out of scope, so it must be copied.
+      if (cached)
+      {
+        testFeatures = dataset;
+        testLabels = labels;
+      }
+      else
+      {
+        testFeatures = std::move(dataset);
+        testLabels = std::move(labels);
+      }
+      testImages = LazyDataset<DatasetX>();
+      return;
+    }
+
+    // Train-validation data split. Decoded images are split in place, a
+    // cached dataset is copied straight into the training and validation
+    // sets.
+    SplitDataset(dataset, labels, validRatio, shuffle, !cached);
+
+    trainImages = LazyDataset<DatasetX>();
+    validImages = LazyDataset<DatasetX>();
+
+    // Images were resized above, so only the remaining augmentations are
+    // applied. Validation images aren't augmented.
+    AugmentTrainSet(RemoveResizeParam(augmentations), augmentationProbability,
+        outputWidth, outputHeight, imageDepth);
+  }
 
   mlpack::Log::Info << "Found " << totalClasses << " classes." << std::endl;
 
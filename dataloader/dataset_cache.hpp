@@ -0,0 +1,278 @@
+/**
+ * @file dataset_cache.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of DatasetCache class that stores decoded image datasets on
+ * disk.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_DATALOADER_DATASET_CACHE_HPP
+#define MODELS_DATALOADER_DATASET_CACHE_HPP
+
+#include <mlpack/core.hpp>
+#include <utils/mapped_file.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/crc.hpp>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * On-disk cache of decoded (and resized) images and their labels. A cache
+ * file holds a 64 byte header followed by the key, and the raw column-major
+ * features and labels, each aligned to 64 bytes. Cache files are memory-mapped when they
+ * are loaded, so features and labels alias the mapped memory and no image is
+ * decoded.
+ *
+ * Cache files are named after the CRC32 of a key that describes the source
+ * images (paths, labels, modification times and sizes) and the decoded shape,
+ * so a changed image or shape creates a new cache file. The full key is
+ * stored in the file and compared when it is loaded, so keys with the same
+ * CRC32 never share a cache file.
+ *
+ * @code
+ * const std::string key = DatasetCache<>::Key(paths, labels, 32, 32, 3, "");
+ * DatasetCache<> cache;
+ * if (!cache.Load("./cache/", key))
+ *   DatasetCache<>::Save("./cache/", key, features, labels);
+ * @endcode
+ *
+ * @tparam DatasetX Datatype for loading input features.
+ * @tparam DatasetY Datatype for prediction features.
+ */
+template<
+  typename DatasetX = arma::mat,
+  typename DatasetY = arma::mat
+>
+class DatasetCache
+{
+ public:
+  /**
+   * Creates a key describing a set of images. Modification times and sizes
+   * of images are part of the key.
+   *
+   * @param imagePaths Paths of images.
+   * @param imageLabels Labels of images.
+   * @param imageWidth Width of the images before resizing.
+   * @param imageHeight Height of the images before resizing.
+   * @param imageDepth Depth of the images.
+   * @param resizeParam Resize augmentation applied to the images, if any.
+   */
+  static std::string Key(const std::vector<std::string>& imagePaths,
+                         const std::vector<size_t>& imageLabels,
+                         const size_t imageWidth,
+                         const size_t imageHeight,
+                         const size_t imageDepth,
+                         const std::string& resizeParam)
+  {
+    std::ostringstream key;
+    key << imageWidth << " " << imageHeight << " " << imageDepth << " " <<
+        resizeParam << "\n";
+
+    for (size_t i = 0; i < imagePaths.size(); i++)
+    {
+      boost::system::error_code error;
+      const std::time_t time = boost::filesystem::last_write_time(
+          imagePaths[i], error);
+      const uintmax_t size = boost::filesystem::file_size(imagePaths[i],
+          error);
+
+      key << imagePaths[i] << " " << imageLabels[i] << " " << time << " " <<
+          size << "\n";
+    }
+
+    return key.str();
+  }
+
+  /**
+   * Maps the cache file of the given key. Features and labels alias the
+   * mapped memory, so they are only valid while this object exists.
+   *
+   * @param cachePath Directory holding cache files.
+   * @param key Key created with Key().
+   * @return true if a valid cache file was found else false.
+   */
+  bool Load(const std::string& cachePath, const std::string& key)
+  {
+    features.reset();
+    labels.reset();
+    if (!file.Open(FileName(cachePath, key)) || file.Size() < sizeof(Header))
+      return false;
+
+    Header header;
+    std::memcpy(&header, file.Data(), sizeof(Header));
+
+    const size_t keyBytes = Align(header.keyLength);
+    const size_t featureBytes = Align(header.featureRows *
+        header.featureCols * sizeof(FeatureType));
+    const size_t labelBytes = header.labelRows * header.labelCols *
+        sizeof(LabelType);
+
+    if (std::memcmp(header.magic, Magic(), sizeof(header.magic)) != 0 ||
+        header.keyHash != Hash(key) || header.keyLength != key.length() ||
+        header.featureSize != sizeof(FeatureType) ||
+        header.labelSize != sizeof(LabelType) ||
+        file.Size() != sizeof(Header) + keyBytes + featureBytes + labelBytes ||
+        std::memcmp(file.Data() + sizeof(Header), key.data(),
+        key.length()) != 0)
+    {
+      mlpack::Log::Warn << "Ignoring invalid cache file " <<
+          FileName(cachePath, key) << "." << std::endl;
+      file.Close();
+      return false;
+    }
+
+    char* data = file.Data() + sizeof(Header) + keyBytes;
+    features.reset(new DatasetX(reinterpret_cast<FeatureType*>(data),
+        header.featureRows, header.featureCols, false, true));
+    labels.reset(new DatasetY(reinterpret_cast<LabelType*>(data +
+        featureBytes), header.labelRows, header.labelCols, false, true));
+
+    mlpack::Log::Info << "Loaded " << header.featureCols << " images from " <<
+        FileName(cachePath, key) << "." << std::endl;
+    return true;
+  }
+
+  /**
+   * Writes a cache file for the given key. The file is written under a
+   * temporary name and renamed, so an interrupted write never leaves a
+   * partial cache file.
+   *
+   * @param cachePath Directory holding cache files.
+   * @param key Key created with Key().
+   * @param features Decoded images, one per column.
+   * @param labels Labels of the images.
+   * @return true if the cache file was written else false.
+   */
+  static bool Save(const std::string& cachePath,
+                   const std::string& key,
+                   const DatasetX& features,
+                   const DatasetY& labels)
+  {
+    boost::system::error_code error;
+    boost::filesystem::create_directories(cachePath, error);
+
+    const std::string fileName = FileName(cachePath, key);
+    const std::string tempName = fileName + ".tmp";
+    std::ofstream output(tempName, std::ios::binary);
+    if (!output.is_open())
+    {
+      mlpack::Log::Warn << "Unable to write cache file " << fileName << "."
+          << std::endl;
+      return false;
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(Header));
+    std::memcpy(header.magic, Magic(), sizeof(header.magic));
+    header.keyHash = Hash(key);
+    header.keyLength = key.length();
+    header.featureSize = sizeof(FeatureType);
+    header.labelSize = sizeof(LabelType);
+    header.featureRows = features.n_rows;
+    header.featureCols = features.n_cols;
+    header.labelRows = labels.n_rows;
+    header.labelCols = labels.n_cols;
+
+    const size_t featureBytes = features.n_elem * sizeof(FeatureType);
+    const std::vector<char> padding(64, 0);
+
+    output.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    output.write(key.data(), key.length());
+    output.write(padding.data(), Align(key.length()) - key.length());
+    output.write(reinterpret_cast<const char*>(features.memptr()),
+        featureBytes);
+    output.write(padding.data(), Align(featureBytes) - featureBytes);
+    output.write(reinterpret_cast<const char*>(labels.memptr()),
+        labels.n_elem * sizeof(LabelType));
+    output.close();
+
+    if (!output)
+    {
+      boost::filesystem::remove(tempName, error);
+      mlpack::Log::Warn << "Unable to write cache file " << fileName << "."
+          << std::endl;
+      return false;
+    }
+
+    boost::filesystem::rename(tempName, fileName, error);
+    return !error;
+  }
+
+  //! Get the features of the loaded cache file.
+  DatasetX& Features() { return *features; }
+
+  //! Get the labels of the loaded cache file.
+  DatasetY& Labels() { return *labels; }
+
+ private:
+  //! Type of a single feature.
+  typedef typename DatasetX::elem_type FeatureType;
+
+  //! Type of a single label.
+  typedef typename DatasetY::elem_type LabelType;
+
+  //! Header at the start of a cache file.
+  struct Header
+  {
+    char magic[8];
+    uint32_t keyHash;
+    uint32_t keyLength;
+    uint32_t featureSize;
+    uint32_t labelSize;
+    uint64_t featureRows;
+    uint64_t featureCols;
+    uint64_t labelRows;
+    uint64_t labelCols;
+    char reserved[8];
+  };
+
+  static_assert(sizeof(Header) == 64, "Cache header must be 64 bytes.");
+
+  //! Get the magic bytes identifying a cache file.
+  static const char* Magic() { return "MLPKDSC2"; }
+
+  //! Rounds the given number of bytes up to a multiple of 64.
+  static size_t Align(const size_t bytes) { return (bytes + 63) / 64 * 64; }
+
+  //! Get the CRC32 of a key.
+  static uint32_t Hash(const std::string& key)
+  {
+    boost::crc_32_type crc;
+    crc.process_bytes(key.data(), key.length());
+    return crc.checksum();
+  }
+
+  //! Get the name of the cache file of a key.
+  static std::string FileName(const std::string& cachePath,
+                              const std::string& key)
+  {
+    std::ostringstream name;
+    name << std::hex << Hash(key) << "_" << std::dec << key.length();
+    return (boost::filesystem::path(cachePath) /
+        ("dataset_" + name.str() + ".bin")).string();
+  }
+
+  //! Mapped cache file.
+  MappedFile file;
+
+  //! Features aliasing the mapped cache file.
+  std::unique_ptr<DatasetX> features;
+
+  //! Labels aliasing the mapped cache file.
+  std::unique_ptr<DatasetY> labels;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
@@ -0,0 +1,212 @@
+/**
+ * @file lazy_dataset.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of LazyDataset class for image datasets that are decoded on
+ * demand.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_DATALOADER_LAZY_DATASET_HPP
+#define MODELS_DATALOADER_LAZY_DATASET_HPP
+
+#include <augmentation/augmentation.hpp>
+#include <mlpack/core.hpp>
+#include <utils/utils.hpp>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * File-backed image dataset. Only paths and shapes of images are held in
+ * memory and images are decoded when they are requested, so the dataset
+ * isn't limited by the available memory.
+ *
+ * @code
+ * LazyDataset<> dataset(64, 64, 3);
+ * dataset.Add("path/to/image.jpg", 120, 80, 3);
+ *
+ * // Decode the first image, resized to 64 x 64.
+ * arma::mat images;
+ * dataset.Load(arma::uvec({0}), images);
+ * @endcode
+ *
+ * @tparam DatasetX Datatype for loading input features.
+ */
+template<typename DatasetX = arma::mat>
+class LazyDataset
+{
+ public:
+  //! Create the LazyDataset object.
+  LazyDataset() :
+      imageWidth(0),
+      imageHeight(0),
+      imageDepth(0)
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Create an empty LazyDataset whose images will be decoded with the given
+   * shape.
+   *
+   * @param imageWidth Width of decoded images. Images with a different width
+   *     are resized.
+   * @param imageHeight Height of decoded images. Images with a different
+   *     height are resized.
+   * @param imageDepth Depth / Number of channels of decoded images.
+   */
+  LazyDataset(const size_t imageWidth,
+              const size_t imageHeight,
+              const size_t imageDepth) :
+      imageWidth(imageWidth),
+      imageHeight(imageHeight),
+      imageDepth(imageDepth)
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Adds an image to the dataset. The image isn't read.
+   *
+   * @param path Path to the image.
+   * @param width Width of the image stored at path.
+   * @param height Height of the image stored at path.
+   * @param depth Depth of the image stored at path.
+   */
+  void Add(const std::string& path,
+           const size_t width,
+           const size_t height,
+           const size_t depth)
+  {
+    paths.push_back(path);
+    shapes.push_back(std::make_tuple(width, height, depth));
+  }
+
+  /**
+   * Creates a dataset holding the given images of this dataset.
+   *
+   * @param indices Indices of images in this dataset.
+   * @return Dataset containing the images in the order of indices.
+   */
+  LazyDataset Subset(const arma::uvec& indices) const
+  {
+    LazyDataset subset(imageWidth, imageHeight, imageDepth);
+    subset.resizeParam = resizeParam;
+    subset.paths.reserve(indices.n_elem);
+    subset.shapes.reserve(indices.n_elem);
+    for (size_t i = 0; i < indices.n_elem; i++)
+    {
+      subset.paths.push_back(paths[indices(i)]);
+      subset.shapes.push_back(shapes[indices(i)]);
+    }
+
+    return subset;
+  }
+
+  /**
+   * Decodes the given images in parallel. Each image is stored in its own
+   * column and resized if its shape differs from the shape of the dataset.
+   * Columns of images that can't be decoded are filled with zeros.
+   *
+   * @param indices Indices of images that will be decoded.
+   * @param images Matrix where decoded images will be stored.
+   * @param numThreads Number of threads used for decoding. If 0, all
+   *     available threads are used.
+   */
+  void Load(const arma::uvec& indices,
+            DatasetX& images,
+            const size_t numThreads = 0) const
+  {
+    images.zeros(imageWidth * imageHeight * imageDepth, indices.n_elem);
+
+    // Used for images whose shape differs from the shape of the dataset.
+    const std::string param = resizeParam.empty() ? "resize (" +
+        std::to_string(imageWidth) + ", " + std::to_string(imageHeight) + ")" :
+        resizeParam;
+    Augmentation resize(std::vector<std::string>(1, param), 0.0);
+
+    #pragma omp parallel for num_threads(Utils::NumThreads(numThreads)) \
+        schedule(dynamic)
+    for (omp_size_t i = 0; i < (omp_size_t) indices.n_elem; i++)
+    {
+      const size_t index = indices(i);
+      const size_t width = std::get<0>(shapes[index]);
+      const size_t height = std::get<1>(shapes[index]);
+      const size_t depth = std::get<2>(shapes[index]);
+
+      mlpack::data::ImageInfo imageInfo(width, height, depth);
+      DatasetX image;
+      if (!mlpack::data::Load(paths[index], image, imageInfo))
+        continue;
+
+      if (width != imageWidth || height != imageHeight)
+        resize.ResizeTransform(image, width, height, depth, param, 1);
+
+      if (image.n_rows != images.n_rows)
+      {
+        #pragma omp critical
+        mlpack::Log::Warn << "Skipping " << paths[index] << " as its shape "
+            << "doesn't match the shape of the dataset." << std::endl;
+        continue;
+      }
+
+      images.col(i) = image;
+    }
+  }
+
+  //! Get the number of images in the dataset.
+  size_t Size() const { return paths.size(); }
+
+  //! Get the paths of images in the dataset.
+  const std::vector<std::string>& Paths() const { return paths; }
+
+  //! Get the width of decoded images.
+  size_t ImageWidth() const { return imageWidth; }
+  //! Modify the width of decoded images.
+  size_t& ImageWidth() { return imageWidth; }
+
+  //! Get the height of decoded images.
+  size_t ImageHeight() const { return imageHeight; }
+  //! Modify the height of decoded images.
+  size_t& ImageHeight() { return imageHeight; }
+
+  //! Get the depth of decoded images.
+  size_t ImageDepth() const { return imageDepth; }
+  //! Modify the depth of decoded images.
+  size_t& ImageDepth() { return imageDepth; }
+
+  //! Get the transform used to resize decoded images, such as
+  //! "letterbox (416, 416)". If empty, images are stretched to the shape of
+  //! the dataset.
+  const std::string& ResizeParam() const { return resizeParam; }
+  //! Modify the transform used to resize decoded images.
+  std::string& ResizeParam() { return resizeParam; }
+
+ private:
+  //! Locally stored paths of images.
+  std::vector<std::string> paths;
+
+  //! Locally stored width, height and depth of each image.
+  std::vector<std::tuple<size_t, size_t, size_t>> shapes;
+
+  //! Locally stored width of decoded images.
+  size_t imageWidth;
+
+  //! Locally stored height of decoded images.
+  size_t imageHeight;
+
+  //! Locally stored depth of decoded images.
+  size_t imageDepth;
+
+  //! Locally stored transform used to resize decoded images.
+  std::string resizeParam;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
@@ -60,13 +60,21 @@ class PreProcessor
   }
 
   /**
-   * Converts image to channel first format used in PyTorch. Performs the same function
-   * as torch.transforms.ToTensor().
+   * Converts images to the channel first format used in PyTorch. Performs the
+   * same function as torch.transforms.ToTensor(). Images are read in the
+   * interleaved layout used by mlpack::data::Load(), where channels of a
+   * pixel are consecutive, and each channel is stored one after another.
    *
-   * @param trainFeatures Input features that will be converted into channel first format.
+   * Images are converted in parallel. Each image is transposed in blocks of
+   * pixels that fit in the cache, and normalized in the same pass.
+   *
+   * @param trainFeatures Input features that will be converted into channel
+   *     first format, one image per column.
    * @param imageWidth Width of the image in dataset.
    * @param imageHeight Height of the image in dataset.
    * @param imageDepth Depth / Number of channels of the image in dataset.
+   * @param normalize Whether each element is converted to an 8-bit pixel and
+   *     divided by 255.
    */
   static void ChannelFirstImages(DatasetX& trainFeatures,
       const size_t imageWidth,
@@ -74,26 +82,93 @@ class PreProcessor
       const size_t imageDepth,
       bool normalize = true)
   {
-    for (size_t idx = 0; idx < trainFeatures.n_cols; idx++)
+    typedef typename DatasetX::elem_type ElemType;
+
+    const size_t pixels = imageWidth * imageHeight;
+    mlpack::Log::Assert(trainFeatures.n_rows == pixels * imageDepth,
+        "Shape of images doesn't match the number of rows.");
+
+    // Pixels of a block of 3 channels of doubles take 6 KB.
+    const size_t blockSize = 256;
+
+    #pragma omp parallel
     {
-        // Create a copy of the current image so that the image isn't affected.
-        arma::cube inputTemp(trainFeatures.col(idx).memptr(), 3, 224, 224);
+      std::vector<ElemType> image(trainFeatures.n_rows);
+
+      #pragma omp for schedule(static)
+      for (omp_size_t col = 0; col < (omp_size_t) trainFeatures.n_cols; col++)
+      {
+        ElemType* output = trainFeatures.colptr(col);
+        std::copy(output, output + trainFeatures.n_rows, image.begin());
 
-        size_t currentOffset = 0;
-        for (size_t i = 0; i < inputTemp.n_slices; i++)
+        for (size_t first = 0; first < pixels; first += blockSize)
         {
-          trainFeatures.col(idx)(arma::span(currentOffset, currentOffset +
-              inputTemp.slice(i).n_elem - 1), arma::span()) =
-              arma::vectorise(inputTemp.slice(i).t());
-          currentOffset += inputTemp.slice(i).n_elem;
+          const size_t last = std::min(first + blockSize, pixels);
+          for (size_t c = 0; c < imageDepth; c++)
+          {
+            const ElemType* input = image.data() + c;
+            ElemType* channel = output + c * pixels;
+            if (normalize)
+            {
+              for (size_t p = first; p < last; p++)
+              {
+                channel[p] = (ElemType) ((uint8_t) input[p * imageDepth] /
+                    255.0);
+              }
+            }
+            else
+            {
+              for (size_t p = first; p < last; p++)
+                channel[p] = input[p * imageDepth];
+            }
+          }
         }
+      }
     }
+  }
+
+  /**
+   * Converts a batch of images to the element type used by a model, e.g.
+   * from 8-bit pixels to doubles. Pixels are scaled and the mean of each
+   * channel is subtracted in the same pass. Images must be in the
+   * interleaved layout used by mlpack::data::Load(), where channels of a
+   * pixel are consecutive.
+   *
+   * @param input Images that will be converted, one per column.
+   * @param output Matrix where converted images will be stored.
+   * @param scale Factor each pixel is multiplied with, e.g. 1 / 255.0.
+   * @param mean Mean of each channel, subtracted after scaling. A single
+   *     element is subtracted from every channel. If empty, no mean is
+   *     subtracted.
+   */
+  template<typename InputElemType, typename OutputElemType>
+  static void ConvertImages(const arma::Mat<InputElemType>& input,
+                            arma::Mat<OutputElemType>& output,
+                            const double scale = 1.0,
+                            const arma::vec& mean = arma::vec())
+  {
+    mlpack::Log::Assert(mean.n_elem == 0 || input.n_rows % mean.n_elem == 0,
+        "Number of rows must be a multiple of the number of channels.");
+
+    const size_t channels = std::max((size_t) mean.n_elem, (size_t) 1);
+    const arma::vec channelMean = mean.n_elem > 0 ? mean : arma::vec(1,
+        arma::fill::zeros);
+
+    output.set_size(input.n_rows, input.n_cols);
 
-    if (normalize)
+    #pragma omp parallel for
+    for (omp_size_t col = 0; col < (omp_size_t) input.n_cols; col++)
     {
-      // Convert each element to uint8 first and then divide by 255.
-      for (size_t i = 0; i < trainFeatures.n_elem; i++)
-          trainFeatures(i) = ((uint8_t)(trainFeatures(i)) / 255.0);
+      const InputElemType* image = input.colptr(col);
+      OutputElemType* converted = output.colptr(col);
+      for (size_t i = 0; i < input.n_rows; i += channels)
+      {
+        for (size_t c = 0; c < channels; c++)
+        {
+          converted[i + c] = (OutputElemType) (image[i + c] * scale -
+              channelMean(c));
+        }
+      }
     }
   }
 
@@ -114,6 +189,10 @@ class PreProcessor
    * @param normalize Boolean to determine whether coordinates are to
    *    to be normalized or not. Defaults to true.
    *
+   * Images are encoded in parallel. Boxes whose class is negative are padding
+   * and are skipped, and a class that isn't less than numClasses is a fatal
+   * error. For YOLOv2 or higher, boxes beyond numBoxes in a cell are dropped.
+   *
    * Note : This function must be called manually before model is used.
    */
   template<typename eT>
@@ -135,7 +214,7 @@ class PreProcessor
     mlpack::Log::Assert(typeid(annotations) == typeid(arma::field<arma::vec>),
         "Use Field type to represent annotations.");
 
-    size_t batchSize = annotations.n_cols;
+    const size_t batchSize = annotations.n_cols;
     size_t numPredictions = 5 * numBoxes + numClasses;
     if (version > 1)
     {
@@ -143,126 +222,526 @@ class PreProcessor
       numPredictions = numBoxes * (5 + numClasses);
     }
 
-    double cellSizeHeight = (double) 1.0 / gridHeight;
-    double cellSizeWidth = (double) 1.0 / gridWidth;
+    const double cellSizeHeight = (double) 1.0 / gridHeight;
+    const double cellSizeWidth = (double) 1.0 / gridWidth;
 
-    // Set size of output and use cubes convenience.
-    output.set_size(gridWidth * gridHeight * numPredictions, batchSize);
-    output.zeros();
+    CheckClasses(annotations, numClasses);
 
-    // Use offset to create a cube for a particular column / batch.
-    size_t offset = 0;
-    for (size_t boxIdx = 0; boxIdx < batchSize; boxIdx++)
+    // Targets of an image are stored as a gridWidth x gridHeight x
+    // numPredictions cube, so cell (gridX, gridY) is at gridX + gridWidth *
+    // gridY and each prediction of a cell is a stride of cells apart.
+    const size_t cells = gridWidth * gridHeight;
+    output.set_size(cells * numPredictions, batchSize);
+
+    #pragma omp parallel
     {
-      arma::cube outputTemp(const_cast<arma::Mat<eT> &>(output).memptr() +
-          offset, gridHeight, gridWidth, numPredictions, false, false);
-      offset += gridWidth * gridHeight * numPredictions;
-
-      // Get the bounding box and labels corresponding to current image.
-      arma::mat labels(1, annotations(0, boxIdx).n_elem / 5);
-      arma::mat boundingBoxes(4, annotations(0, boxIdx).n_elem / 5);
-      for (size_t i = 0; i < boundingBoxes.n_cols; i++)
+      // For YOLOv2 or higher, each bounding box can represent a class
+      // so we don't repeat labels as done for YOLOv1. Number of bounding
+      // boxes already assigned to each cell.
+      std::vector<size_t> cellBoxes(cells);
+
+      #pragma omp for schedule(static)
+      for (omp_size_t col = 0; col < (omp_size_t) batchSize; col++)
       {
-        labels.col(i)(0) = annotations(0, boxIdx)(i * 5);
-        boundingBoxes.col(i) = annotations(0, boxIdx)(arma::span(i * 5 + 1,
-            (i + 1) * 5 - 1));
+        eT* target = output.colptr(col);
+        std::fill(target, target + output.n_rows, eT(0));
+        std::fill(cellBoxes.begin(), cellBoxes.end(), 0);
+
+        const arma::vec& boxes = annotations(0, col);
+        for (size_t i = 0; i < boxes.n_elem / 5; i++)
+        {
+          // Boxes with a negative class pad the annotations.
+          const double* box = boxes.memptr() + 5 * i;
+          if (box[0] < 0)
+            continue;
+
+          // Normalize the coordinates, and get the width, height and centre
+          // of the bounding box.
+          const double x1 = box[1] / imageWidth, y1 = box[2] / imageHeight;
+          const double x2 = box[3] / imageWidth, y2 = box[4] / imageHeight;
+          const double boxWidth = x2 - x1, boxHeight = y2 - y1;
+          double centreX = (x1 + x2) / 2.0, centreY = (y1 + y2) / 2.0;
+
+          // Index for representing bounding box on grid.
+          const size_t gridX = GridIndex(centreX, cellSizeWidth, gridWidth);
+          const size_t gridY = GridIndex(centreY, cellSizeHeight, gridHeight);
+          if (normalize)
+          {
+            // Normalize to 1.0 within the cell.
+            centreX = (centreX - gridX * cellSizeWidth) / cellSizeWidth;
+            centreY = (centreY - gridY * cellSizeHeight) / cellSizeHeight;
+          }
+
+          const size_t label = (size_t) box[0];
+          eT* cell = target + gridX + gridWidth * gridY;
+          if (version == 1)
+          {
+            // Fill elements in the grid.
+            for (size_t k = 0; k < numBoxes; k++)
+            {
+              eT* prediction = cell + 5 * k * cells;
+              prediction[0] = (eT) centreX;
+              prediction[cells] = (eT) centreY;
+              prediction[2 * cells] = (eT) boxWidth;
+              prediction[3 * cells] = (eT) boxHeight;
+              prediction[4 * cells] = 1;
+            }
+            cell[(5 * numBoxes + label) * cells] = 1;
+          }
+          else
+          {
+            const size_t s = cellBoxes[cell - target]++;
+            if (s >= numBoxes)
+              continue;
+
+            eT* prediction = cell + (5 + numClasses) * s * cells;
+            prediction[0] = (eT) centreX;
+            prediction[cells] = (eT) centreY;
+            prediction[2 * cells] = (eT) boxWidth;
+            prediction[3 * cells] = (eT) boxHeight;
+            prediction[4 * cells] = 1;
+            prediction[(5 + label) * cells] = 1;
+          }
+        }
       }
+    }
+  }
 
-      // For YOLOv2 or higher, each bounding box can represent a class
-      // so we don't repeat labels as done for YOLOv1. We will use map
-      // to store last inserted bounding box.
-      std::map<std::pair<size_t, size_t>, size_t> boundingBoxOffset;
-
-      // Normalize the coordinates.
-      boundingBoxes.row(0) /= imageWidth;
-      boundingBoxes.row(2) /= imageWidth;
-      boundingBoxes.row(1) /= imageHeight;
-      boundingBoxes.row(3) /= imageHeight;
-
-      // Get width and height as well as centres for the bounding box.
-      arma::mat widthAndHeight(2, boundingBoxes.n_cols);
-      widthAndHeight.row(0) = (boundingBoxes.row(2) - boundingBoxes.row(0));
-      widthAndHeight.row(1) = (boundingBoxes.row(3) - boundingBoxes.row(1));
-
-      arma::mat centres(2, boundingBoxes.n_cols);
-      centres.row(0) = (boundingBoxes.row(2) + boundingBoxes.row(0)) / 2.0;
-      centres.row(1) = (boundingBoxes.row(3) + boundingBoxes.row(1)) / 2.0;
-
-      // Assign bounding boxes to the grid.
-      for (size_t i = 0; i < boundingBoxes.n_cols; i++)
+  /**
+   * Anchor-based PreProcessor for YOLOv2 and YOLOv3 models. Each bounding box
+   * is assigned to the anchor box with the highest IoU, and written to the
+   * cell containing its centre in the grid of that anchor's scale. Targets
+   * of a box are:
+   *
+   *  - x and y: offset of the centre within the cell, in [0, 1).
+   *  - w and h: log(box size / anchor size).
+   *  - Objectness 1 and a one-hot encoding of the class.
+   *
+   * Targets of each scale are stored as a gridWidth x gridHeight x
+   * (anchorsPerScale * (5 + numClasses)) cube, in the layout of feature maps
+   * of mlpack's convolutions, and the cubes of all scales are stacked in each
+   * column of the output. If two boxes get the same cell and anchor, the
+   * last one is kept. Boxes whose class is negative are padding and are
+   * skipped, and a class that isn't less than numClasses is a fatal error.
+   *
+   * @code
+   * // YOLOv3 anchors for 416 x 416 images, 3 per scale.
+   * arma::mat anchors({{116, 156, 373, 30, 62, 59, 10, 16, 33},
+   *                    {90, 198, 326, 61, 45, 119, 13, 30, 23}});
+   * arma::umat grids({{13, 26, 52}, {13, 26, 52}});
+   * PreProcessor<arma::mat, arma::field<arma::vec>>::YOLOPreProcessor(
+   *     annotations, targets, anchors, grids, 416, 416, 80);
+   * @endcode
+   *
+   * @param annotations Field object created using model's dataloader containing
+   *     annotation for images.
+   * @param output Output matrix where output will be stored.
+   * @param anchors Width and height of each anchor box in pixels, one anchor
+   *     per column. Anchors are grouped by scale, in the order of gridSizes.
+   * @param gridSizes Width and height of the output feature map of each
+   *     scale, one scale per column.
+   * @param imageWidth Width of image used for training YOLO model.
+   * @param imageHeight Height of image used for training YOLO model.
+   * @param numClasses Number of classes in training set.
+   */
+  template<typename eT>
+  static void YOLOPreProcessor(const DatasetY& annotations,
+                               arma::Mat<eT>& output,
+                               const arma::mat& anchors,
+                               const arma::umat& gridSizes,
+                               const size_t imageWidth = 416,
+                               const size_t imageHeight = 416,
+                               const size_t numClasses = 80)
+  {
+    mlpack::Log::Assert(typeid(annotations) == typeid(arma::field<arma::vec>),
+        "Use Field type to represent annotations.");
+
+    const size_t numScales = gridSizes.n_cols;
+    if (anchors.n_rows != 2 || gridSizes.n_rows != 2 || numScales == 0 ||
+        anchors.n_cols % numScales != 0)
+    {
+      mlpack::Log::Fatal << "Anchors must have a width and a height, and an "
+          << "equal number of anchors per scale." << std::endl;
+    }
+
+    // Offset of the targets of each scale in a column.
+    const size_t anchorsPerScale = anchors.n_cols / numScales;
+    const size_t numPredictions = anchorsPerScale * (5 + numClasses);
+    std::vector<size_t> scaleOffsets(numScales + 1, 0);
+    for (size_t i = 0; i < numScales; i++)
+    {
+      scaleOffsets[i + 1] = scaleOffsets[i] + gridSizes(0, i) *
+          gridSizes(1, i) * numPredictions;
+    }
+
+    CheckClasses(annotations, numClasses);
+    output.set_size(scaleOffsets.back(), annotations.n_cols);
+
+    #pragma omp parallel
+    {
+      std::vector<double> widths, heights, iou;
+
+      #pragma omp for schedule(static)
+      for (omp_size_t col = 0; col < (omp_size_t) annotations.n_cols; col++)
       {
-        // Index for representing bounding box on grid.
-        arma::vec gridCoordinates = centres.col(i);
-        arma::vec centreCoordinates = centres.col(i);
+        eT* target = output.colptr(col);
+        std::fill(target, target + output.n_rows, eT(0));
 
-        if (normalize)
+        const arma::vec& boxes = annotations(0, col);
+        const size_t numBoxes = boxes.n_elem / 5;
+        widths.resize(numBoxes);
+        heights.resize(numBoxes);
+        for (size_t i = 0; i < numBoxes; i++)
         {
-          gridCoordinates(0) = std::ceil(gridCoordinates(0) /
-              cellSizeWidth) - 1;
-          gridCoordinates(1) = std::ceil(gridCoordinates(1) /
-              cellSizeHeight) - 1;
+          widths[i] = boxes(5 * i + 3) - boxes(5 * i + 1);
+          heights[i] = boxes(5 * i + 4) - boxes(5 * i + 2);
         }
-        else
+
+        iou.resize(numBoxes * anchors.n_cols);
+        AnchorIoU(widths.data(), heights.data(), numBoxes, anchors,
+            iou.data());
+
+        for (size_t i = 0; i < numBoxes; i++)
         {
-          gridCoordinates(0) = std::ceil((gridCoordinates(0) /
-              imageWidth) / cellSizeWidth) - 1;
-          gridCoordinates(1) = std::ceil((gridCoordinates(1) /
-              imageHeight) / cellSizeHeight) - 1;
+          // Boxes with a negative class pad the annotations.
+          const double* box = boxes.memptr() + 5 * i;
+          if (box[0] < 0 || widths[i] <= 0 || heights[i] <= 0)
+            continue;
+
+          size_t anchor = 0;
+          for (size_t j = 1; j < anchors.n_cols; j++)
+          {
+            if (iou[j * numBoxes + i] > iou[anchor * numBoxes + i])
+              anchor = j;
+          }
+
+          const size_t scale = anchor / anchorsPerScale;
+          const size_t gridWidth = gridSizes(0, scale);
+          const size_t gridHeight = gridSizes(1, scale);
+          const size_t cells = gridWidth * gridHeight;
+
+          // Centre of the box in units of cells.
+          const double centreX = (box[1] + box[3]) / 2.0 / imageWidth *
+              gridWidth;
+          const double centreY = (box[2] + box[4]) / 2.0 / imageHeight *
+              gridHeight;
+          const size_t gridX = (size_t) std::min(std::max(std::floor(centreX),
+              0.0), gridWidth - 1.0);
+          const size_t gridY = (size_t) std::min(std::max(std::floor(centreY),
+              0.0), gridHeight - 1.0);
+
+          eT* prediction = target + scaleOffsets[scale] + gridX +
+              gridWidth * gridY + (anchor % anchorsPerScale) *
+              (5 + numClasses) * cells;
+          prediction[0] = (eT) (centreX - gridX);
+          prediction[cells] = (eT) (centreY - gridY);
+          prediction[2 * cells] = (eT) std::log(widths[i] /
+              anchors(0, anchor));
+          prediction[3 * cells] = (eT) std::log(heights[i] /
+              anchors(1, anchor));
+          prediction[4 * cells] = 1;
+          prediction[(5 + (size_t) box[0]) * cells] = 1;
         }
+      }
+    }
+  }
 
-        size_t gridX = gridCoordinates(0);
-        size_t gridY = gridCoordinates(1);
-        gridCoordinates(0) = gridCoordinates(0) * cellSizeWidth;
-        gridCoordinates(1) = gridCoordinates(1) * cellSizeHeight;
+  /**
+   * Computes the IoU of boxes and anchor boxes, both centred at the origin,
+   * so that only their sizes matter.
+   *
+   * @param sizes Width and height of each box, one box per column.
+   * @param anchors Width and height of each anchor box, one per column.
+   * @return Matrix with the IoU of box i and anchor j at (i, j).
+   */
+  static arma::mat AnchorIoU(const arma::mat& sizes, const arma::mat& anchors)
+  {
+    const arma::rowvec widths = sizes.row(0), heights = sizes.row(1);
+    arma::mat iou(sizes.n_cols, anchors.n_cols);
+    AnchorIoU(widths.memptr(), heights.memptr(), sizes.n_cols, anchors,
+        iou.memptr());
+    return iou;
+  }
+
+  /**
+   * Generates anchor boxes for YOLOv2 and YOLOv3 from the bounding boxes of a
+   * dataset, using k-means clustering of box sizes with 1 - IoU as distance.
+   * Centroids are initialized with k-means++ and the clustering is restarted
+   * several times, keeping the anchors with the highest average IoU.
+   *
+   * Boxes are assigned to anchors in parallel, in blocks whose sums are
+   * added in order, so anchors only depend on the seed and not on the number
+   * of threads.
+   *
+   * @code
+   * arma::field<arma::vec> labels;
+   * dataloader.LoadObjectDetectionDataset(...);
+   * arma::mat anchors;
+   * const double iou = PreProcessor<arma::mat, arma::field<arma::vec>>::
+   *     YOLOAnchors(dataloader.TrainLabels(), anchors, 9);
+   * @endcode
+   *
+   * @param annotations Field object created using model's dataloader containing
+   *     annotation for images. Boxes whose class is negative are padding and
+   *     are skipped.
+   * @param anchors Matrix where the width and height of each anchor box are
+   *     stored, one anchor per column, sorted by increasing area.
+   * @param numAnchors Number of anchor boxes.
+   * @param restarts Number of times k-means is run.
+   * @param maxIterations Maximum number of iterations of each run.
+   * @param seed Seed used to initialize centroids.
+   * @return Average IoU of boxes with their closest anchor.
+   */
+  static double YOLOAnchors(const DatasetY& annotations,
+                            arma::mat& anchors,
+                            const size_t numAnchors = 9,
+                            const size_t restarts = 3,
+                            const size_t maxIterations = 100,
+                            const size_t seed = 0)
+  {
+    mlpack::Log::Assert(typeid(annotations) == typeid(arma::field<arma::vec>),
+        "Use Field type to represent annotations.");
+
+    std::vector<double> widths, heights;
+    for (size_t col = 0; col < annotations.n_cols; col++)
+    {
+      const arma::vec& boxes = annotations(0, col);
+      for (size_t i = 0; i < boxes.n_elem / 5; i++)
+      {
+        const double* box = boxes.memptr() + 5 * i;
+        if (box[0] >= 0 && box[3] > box[1] && box[4] > box[2])
+        {
+          widths.push_back(box[3] - box[1]);
+          heights.push_back(box[4] - box[2]);
+        }
+      }
+    }
+
+    const size_t n = widths.size();
+    if (numAnchors == 0 || n < numAnchors)
+    {
+      mlpack::Log::Fatal << "Can't generate " << numAnchors << " anchors "
+          << "from " << n << " bounding boxes." << std::endl;
+    }
+
+    // Each block holds the sums of widths, heights and counts of boxes of
+    // each cluster, and the sum of IoU of boxes of the block.
+    const size_t blockSize = 4096;
+    const size_t blocks = (n + blockSize - 1) / blockSize;
+    arma::mat blockSums(3 * numAnchors + 1, blocks);
+    std::vector<size_t> assignments(n);
 
-        // Normalize to 1.0.
-        gridCoordinates = centres.col(i) - gridCoordinates;
-        gridCoordinates(0) /= cellSizeWidth;
-        gridCoordinates(1) /= cellSizeHeight;
+    double bestIoU = -1.0;
+    for (size_t r = 0; r < std::max<size_t>(restarts, 1); r++)
+    {
+      std::seed_seq sequence{(uint32_t) seed, (uint32_t) ((uint64_t) seed >>
+          32), (uint32_t) r, (uint32_t) ((uint64_t) r >> 32)};
+      std::mt19937 generator(sequence);
+      arma::mat centroids;
+      InitAnchors(widths, heights, numAnchors, generator, centroids);
 
-        if (normalize)
-          centreCoordinates = gridCoordinates;
+      std::fill(assignments.begin(), assignments.end(), numAnchors);
+      double iou = 0.0;
+      for (size_t iteration = 0; ; iteration++)
+      {
+        size_t changed = 0;
 
-        if (version == 1)
+        #pragma omp parallel
         {
-          // Fill elements in the grid.
-          for (size_t k = 0; k < numBoxes; k++)
+          std::vector<double> blockIoU(blockSize * numAnchors);
+
+          #pragma omp for schedule(static) reduction(+: changed)
+          for (omp_size_t b = 0; b < (omp_size_t) blocks; b++)
           {
-            size_t s = 5 * k;
-            outputTemp(arma::span(gridX), arma::span(gridY),
-                arma::span(s, s + 1)) = centreCoordinates;
-            outputTemp(arma::span(gridX), arma::span(gridY),
-                arma::span(s + 2, s + 3)) = widthAndHeight.col(i);
-            outputTemp(gridX, gridY, s + 4) = 1.0;
+            const size_t first = (size_t) b * blockSize;
+            changed += AssignAnchors(widths, heights, first,
+                std::min(blockSize, n - first), centroids, assignments,
+                blockSums.colptr(b), blockIoU.data());
           }
-          outputTemp(gridX, gridY, 5 * numBoxes + labels.col(i)(0)) = 1;
         }
-        else
+
+        const arma::vec sums = arma::sum(blockSums, 1);
+        iou = sums(3 * numAnchors) / n;
+        if (changed == 0 || iteration == maxIterations)
+          break;
+
+        // Move each centroid to the mean size of its boxes.
+        for (size_t k = 0; k < numAnchors; k++)
         {
-          size_t s = 0;
-          if (boundingBoxOffset.count({gridX, gridY}))
+          if (sums(3 * k + 2) > 0)
           {
-            s = boundingBoxOffset[{gridX, gridY}] + 1;
-            boundingBoxOffset[{gridX, gridY}]++;
+            centroids(0, k) = sums(3 * k) / sums(3 * k + 2);
+            centroids(1, k) = sums(3 * k + 1) / sums(3 * k + 2);
           }
-          else
-            boundingBoxOffset.insert({{gridX, gridY}, s});
+        }
+      }
 
-          if (s > numBoxes)
-            continue;
+      mlpack::Log::Info << "Average IoU of anchors of run " << r << ": "
+          << iou << "." << std::endl;
+      if (iou > bestIoU)
+      {
+        bestIoU = iou;
+        anchors = centroids;
+      }
+    }
+
+    const arma::uvec order = arma::sort_index(anchors.row(0) %
+        anchors.row(1));
+    anchors = anchors.cols(order);
+    return bestIoU;
+  }
+
+ private:
+  /**
+   * Checks that the class of every bounding box is less than numClasses, so
+   * that it can be used as the offset of a prediction. Padding boxes, whose
+   * class is negative, aren't checked. This is done before images are
+   * encoded in parallel, since errors can't leave a parallel region.
+   *
+   * @param annotations Bounding boxes of each image.
+   * @param numClasses Number of classes in training set.
+   */
+  static void CheckClasses(const DatasetY& annotations,
+                           const size_t numClasses)
+  {
+    for (size_t col = 0; col < annotations.n_cols; col++)
+    {
+      const arma::vec& boxes = annotations(0, col);
+      for (size_t i = 0; i < boxes.n_elem / 5; i++)
+      {
+        if (boxes(5 * i) >= (double) numClasses)
+        {
+          mlpack::Log::Fatal << "Class " << boxes(5 * i) << " of bounding box "
+              << i << " of image " << col << " isn't less than the number of "
+              << "classes, " << numClasses << "." << std::endl;
+        }
+      }
+    }
+  }
+
+  //! Get the cell of the grid containing a normalized coordinate.
+  static size_t GridIndex(const double coordinate,
+                          const double cellSize,
+                          const size_t gridSize)
+  {
+    const double index = std::ceil(coordinate / cellSize) - 1;
+    return (size_t) std::min(std::max(index, 0.0), (double) gridSize - 1);
+  }
+
+  //! Computes the IoU of n boxes and each anchor, stored one anchor after
+  //! another.
+  static void AnchorIoU(const double* widths,
+                        const double* heights,
+                        const size_t n,
+                        const arma::mat& anchors,
+                        double* iou)
+  {
+    for (size_t j = 0; j < anchors.n_cols; j++)
+    {
+      const double anchorWidth = anchors(0, j), anchorHeight = anchors(1, j);
+      double* anchorIoU = iou + j * n;
+
+      #pragma omp simd
+      for (size_t i = 0; i < n; i++)
+      {
+        const double intersection = std::min(widths[i], anchorWidth) *
+            std::min(heights[i], anchorHeight);
+        anchorIoU[i] = intersection / (widths[i] * heights[i] + anchorWidth *
+            anchorHeight - intersection);
+      }
+    }
+  }
+
+  //! Initializes centroids of k-means with k-means++, using 1 - IoU as
+  //! distance.
+  static void InitAnchors(const std::vector<double>& widths,
+                          const std::vector<double>& heights,
+                          const size_t numAnchors,
+                          std::mt19937& generator,
+                          arma::mat& centroids)
+  {
+    const size_t n = widths.size();
+    centroids.set_size(2, numAnchors);
+    std::vector<double> distances(n, 1.0);
+    size_t chosen = std::uniform_int_distribution<size_t>(0, n - 1)(
+        generator);
+    for (size_t k = 0; k < numAnchors; k++)
+    {
+      const double width = widths[chosen], height = heights[chosen];
+      centroids(0, k) = width;
+      centroids(1, k) = height;
+
+      #pragma omp parallel for schedule(static)
+      for (omp_size_t i = 0; i < (omp_size_t) n; i++)
+      {
+        const double intersection = std::min(widths[i], width) *
+            std::min(heights[i], height);
+        distances[i] = std::min(distances[i], 1.0 - intersection /
+            (widths[i] * heights[i] + width * height - intersection));
+      }
+
+      // Draw the next centroid with a probability proportional to the
+      // squared distance to its closest centroid.
+      double total = 0.0;
+      for (size_t i = 0; i < n; i++)
+        total += distances[i] * distances[i];
 
-          size_t bBoxOffset = (5 + numClasses) * s;
-          outputTemp(arma::span(gridX), arma::span(gridY),
-              arma::span(bBoxOffset, bBoxOffset + 1)) = centreCoordinates;
-          outputTemp(arma::span(gridX), arma::span(gridY),
-              arma::span(bBoxOffset + 2,
-                  bBoxOffset + 3)) = widthAndHeight.col(i);
-          outputTemp(gridX, gridY, bBoxOffset + 4) = 1.0;
-          outputTemp(gridX, gridY, bBoxOffset + 5 + labels.col(i)(0)) = 1;
+      double target = std::uniform_real_distribution<double>(0.0, total)(
+          generator);
+      chosen = std::uniform_int_distribution<size_t>(0, n - 1)(generator);
+      for (size_t i = 0; i < n && total > 0; i++)
+      {
+        target -= distances[i] * distances[i];
+        if (target < 0 && distances[i] > 0)
+        {
+          chosen = i;
+          break;
         }
       }
     }
   }
+
+  //! Assigns count boxes from first to the centroid with the highest IoU and
+  //! stores the sums of the block. Returns the number of changed
+  //! assignments.
+  static size_t AssignAnchors(const std::vector<double>& widths,
+                              const std::vector<double>& heights,
+                              const size_t first,
+                              const size_t count,
+                              const arma::mat& centroids,
+                              std::vector<size_t>& assignments,
+                              double* sums,
+                              double* iou)
+  {
+    const size_t numAnchors = centroids.n_cols;
+    AnchorIoU(widths.data() + first, heights.data() + first, count,
+        centroids, iou);
+
+    std::fill(sums, sums + 3 * numAnchors + 1, 0.0);
+    size_t changed = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+      size_t best = 0;
+      for (size_t k = 1; k < numAnchors; k++)
+      {
+        if (iou[k * count + i] > iou[best * count + i])
+          best = k;
+      }
+
+      if (assignments[first + i] != best)
+      {
+        assignments[first + i] = best;
+        changed++;
+      }
+
+      sums[3 * best] += widths[first + i];
+      sums[3 * best + 1] += heights[first + i];
+      sums[3 * best + 2] += 1;
+      sums[3 * numAnchors] += iou[best * count + i];
+    }
+
+    return changed;
+  }
 };
 
 } // namespace models
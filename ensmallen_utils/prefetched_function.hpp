@@ -0,0 +1,190 @@
+/**
+ * @file prefetched_function.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of PrefetchedFunction class to train a network on batches
+ * prepared by a BatchPrefetcher.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+
+#ifndef ENSMALLEN_UTILS_PREFETCHED_FUNCTION_HPP
+#define ENSMALLEN_UTILS_PREFETCHED_FUNCTION_HPP
+
+#include <ensmallen.hpp>
+#include <mlpack/core.hpp>
+#include <dataloader/batch_prefetcher.hpp>
+
+namespace ens {
+
+/**
+ * Differentiable separable function that evaluates a network on batches
+ * prepared in the background by a BatchPrefetcher, so that the optimizer
+ * never waits for the input pipeline. The batch size of the optimizer must
+ * match the batch size of the prefetcher.
+ *
+ * @code
+ * BatchPrefetcher<> prefetcher(dataloader, 32);
+ * PrefetchedFunction<FFN<>> function(model, prefetcher);
+ *
+ * ens::Adam optimizer(0.001, 32);
+ * optimizer.Optimize(function, model.Parameters(), ens::PrintLoss());
+ * @endcode
+ *
+ * @tparam NetworkType Type of network being trained.
+ * @tparam DatasetX Datatype of input features.
+ * @tparam DatasetY Datatype of prediction features.
+ */
+template<
+  typename NetworkType,
+  typename DatasetX = arma::mat,
+  typename DatasetY = arma::mat
+>
+class PrefetchedFunction
+{
+ public:
+  /**
+   * Constructor for PrefetchedFunction class. Parameters of the network are
+   * initialized if they are empty.
+   *
+   * @param network Network that will be trained.
+   * @param prefetcher Prefetcher that prepares the batches.
+   */
+  PrefetchedFunction(NetworkType& network,
+                     mlpack::models::BatchPrefetcher<DatasetX, DatasetY>&
+                        prefetcher) :
+      network(network),
+      prefetcher(prefetcher),
+      nextBegin(0)
+  {
+    if (network.Parameters().is_empty())
+      network.ResetParameters();
+  }
+
+  //! Get the number of data points in an epoch.
+  size_t NumFunctions() const { return prefetcher.NumPoints(); }
+
+  //! The prefetcher shuffles data points at the start of each epoch.
+  void Shuffle() { }
+
+  /**
+   * Evaluates the network on the next batch. The network is evaluated in
+   * testing mode and switched back to training mode afterwards.
+   *
+   * @param parameters Parameters of the network.
+   * @param begin Index of the first data point of the batch.
+   * @param batchSize Number of data points in the batch.
+   */
+  template<typename MatType>
+  double Evaluate(const MatType& /* parameters */,
+                  const size_t begin,
+                  const size_t batchSize)
+  {
+    NextBatch(begin, batchSize);
+    const double loss = network.Evaluate(features, labels);
+    network.SetNetworkMode(true);
+    return loss;
+  }
+
+  /**
+   * Evaluates the network on the next batch and computes the gradient. The
+   * network is put into training mode first, like FFN::EvaluateWithGradient()
+   * does, since Evaluate() or Predict() leave it in testing mode.
+   *
+   * @param parameters Parameters of the network.
+   * @param begin Index of the first data point of the batch.
+   * @param gradient Matrix where the gradient will be stored.
+   * @param batchSize Number of data points in the batch.
+   */
+  template<typename MatType, typename GradType>
+  double EvaluateWithGradient(const MatType& /* parameters */,
+                              const size_t begin,
+                              GradType& gradient,
+                              const size_t batchSize)
+  {
+    NextBatch(begin, batchSize);
+    network.SetNetworkMode(true);
+    network.Forward(features, output);
+    return network.Backward(features, labels, gradient);
+  }
+
+  /**
+   * Computes the gradient of the network on the next batch.
+   *
+   * @param parameters Parameters of the network.
+   * @param begin Index of the first data point of the batch.
+   * @param gradient Matrix where the gradient will be stored.
+   * @param batchSize Number of data points in the batch.
+   */
+  template<typename MatType, typename GradType>
+  void Gradient(const MatType& parameters,
+                const size_t begin,
+                GradType& gradient,
+                const size_t batchSize)
+  {
+    EvaluateWithGradient(parameters, begin, gradient, batchSize);
+  }
+
+ private:
+  /**
+   * Gets the batch starting at begin. If the optimizer restarts an epoch
+   * before the current one is consumed, the prefetcher is reset.
+   *
+   * @param begin Index of the first data point of the batch.
+   * @param batchSize Number of data points in the batch.
+   */
+  void NextBatch(const size_t begin, const size_t batchSize)
+  {
+    if (begin != nextBegin)
+    {
+      if (begin != 0)
+      {
+        mlpack::Log::Fatal << "Batches must be requested in order, expected "
+            << "batch starting at " << nextBegin << " but got " << begin
+            << "." << std::endl;
+      }
+
+      prefetcher.Reset();
+    }
+
+    size_t batchBegin = 0;
+    if (!prefetcher.Next(features, labels, batchBegin))
+      prefetcher.Next(features, labels, batchBegin);
+
+    if (features.n_cols != batchSize)
+    {
+      mlpack::Log::Fatal << "Batch size of the optimizer (" << batchSize
+          << ") doesn't match the batch size of the prefetcher ("
+          << features.n_cols << ")." << std::endl;
+    }
+
+    nextBegin = batchBegin + batchSize;
+    if (nextBegin >= prefetcher.NumPoints())
+      nextBegin = 0;
+  }
+
+  //! Reference to the network being trained.
+  NetworkType& network;
+
+  //! Reference to the prefetcher that prepares the batches.
+  mlpack::models::BatchPrefetcher<DatasetX, DatasetY>& prefetcher;
+
+  //! Index of the first data point of the batch that will be returned next.
+  size_t nextBegin;
+
+  //! Features of the current batch.
+  DatasetX features;
+
+  //! Labels of the current batch.
+  DatasetY labels;
+
+  //! Output of the network for the current batch.
+  arma::mat output;
+};
+
+} // namespace ens
+
+#endif
@@ -110,7 +110,35 @@ class YOLO
   //! Save weights for the model.
   void SaveModel(const std::string& filePath);
 
+  /**
+   * Changes the resolution of input images, e.g. for multi-scale training.
+   * Layers are rebuilt for the new resolution and keep their weights and
+   * batch normalization statistics. The last pooling layer keeps the size
+   * of its output, so the output of the model doesn't change. Its input is
+   * the image downsampled 32 times, which must not be smaller than its
+   * output, so width and height must be larger than 32 * (w - 1) and
+   * 32 * (h - 1) for a model created for w x h = ceil(inputWidth / 32) x
+   * ceil(inputHeight / 32). Create the model for the smallest resolution
+   * that is used.
+   *
+   * @param width Width of input images.
+   * @param height Height of input images.
+   */
+  void SetInputResolution(const size_t width, const size_t height);
+
+  //! Get the width of input images.
+  size_t InputWidth() const { return imageWidth; }
+
+  //! Get the height of input images.
+  size_t InputHeight() const { return imageHeight; }
+
  private:
+  //! Adds the layers of the model for the current input resolution.
+  void Build();
+
+  //! Get the batch normalization layers of the model in order.
+  void BatchNormLayers(std::vector<ann::BatchNorm<>*>& layers);
+
   /**
    * Adds Convolution Block.
    *
@@ -173,28 +201,31 @@ class YOLO
    * @param factor The factor by which input dimensions will be divided.
    * @param type One of "max" or "mean". Determines whether add mean pooling
    *     layer or max pooling layer.
+   * @param outputWidth Width of the output. If 0, the input width divided
+   *     by factor.
+   * @param outputHeight Height of the output. If 0, the input height divided
+   *     by factor.
    */
   void PoolingBlock(const size_t factor = 2,
-                    const std::string type = "max")
+                    const std::string type = "max",
+                    const size_t outputWidth = 0,
+                    const size_t outputHeight = 0)
   {
+    const size_t poolWidth = outputWidth != 0 ? outputWidth :
+        std::ceil(inputWidth * 1.0 / factor);
+    const size_t poolHeight = outputHeight != 0 ? outputHeight :
+        std::ceil(inputHeight * 1.0 / factor);
     if (type == "max")
-    {
-      yolo.Add(new ann::AdaptiveMaxPooling<>(
-          std::ceil(inputWidth * 1.0 / factor),
-          std::ceil(inputHeight * 1.0 / factor)));
-    }
+      yolo.Add(new ann::AdaptiveMaxPooling<>(poolWidth, poolHeight));
     else
-    {
-      yolo.Add(new ann::AdaptiveMeanPooling<>(std::ceil(inputWidth * 1.0 /
-          factor), std::ceil(inputHeight * 1.0 / factor)));
-    }
+      yolo.Add(new ann::AdaptiveMeanPooling<>(poolWidth, poolHeight));
 
     mlpack::Log::Info << "Pooling Layer.  ";
     mlpack::Log::Info << "(" << inputWidth << ", " << inputHeight <<
         ") ----> ";
     // Update inputWidth and inputHeight.
-    inputWidth = std::ceil(inputWidth * 1.0 / factor);
-    inputHeight = std::ceil(inputHeight * 1.0 / factor);
+    inputWidth = poolWidth;
+    inputHeight = poolHeight;
 
     mlpack::Log::Info << "(" << inputWidth << ", " << inputHeight <<
         ")" << std::endl;
@@ -229,6 +260,20 @@ class YOLO
   //! Locally stored height of the image.
   size_t inputHeight;
 
+  //! Locally stored width of input images. inputWidth holds the width of
+  //! the feature map while layers are added.
+  size_t imageWidth;
+
+  //! Locally stored height of input images.
+  size_t imageHeight;
+
+  //! Locally stored size of the output of the last pooling layer, which
+  //! doesn't change with the input resolution.
+  size_t poolWidth, poolHeight;
+
+  //! Locally stored whether the fully connected top is added.
+  bool includeTop;
+
   //! Locally stored number of output classes.
   size_t numClasses;
 
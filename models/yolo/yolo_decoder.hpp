@@ -0,0 +1,419 @@
+/**
+ * @file yolo_decoder.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of YOLODecoder class that turns predictions of YOLO models into
+ * bounding boxes.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_YOLO_YOLO_DECODER_HPP
+#define MODELS_MODELS_YOLO_YOLO_DECODER_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Decodes a batch of YOLO predictions into bounding boxes. Predictions use the
+ * layout of targets of PreProcessor::YOLOPreProcessor(), either per grid cell
+ * as in YOLOv1, or per anchor and scale as in YOLOv2 and YOLOv3. Anchor-based
+ * predictions are expected after the activations of the model, i.e. x and y
+ * are offsets within the cell, w and h are log(box size / anchor size), and
+ * objectness and class probabilities are in [0, 1].
+ *
+ * Boxes whose objectness is below the score threshold are skipped before
+ * their classes are read. The score of a box for a class is its objectness
+ * times the probability of the class, and a candidate is kept for each class
+ * whose score reaches the threshold. Candidates of each class then go
+ * through non-maximum suppression. Images are decoded in parallel.
+ *
+ * Detections of an image are stored as class, x1, y1, x2, y2, score in pixels
+ * of the image, so the first five elements of each detection match the
+ * annotations loaded by DataLoader::LoadObjectDetectionDataset().
+ *
+ * @code
+ * YOLO<> yolo(3, 448, 448, 20, 2);
+ * arma::mat predictions;
+ * yolo.GetModel().Predict(images, predictions);
+ *
+ * YOLODecoder decoder(448, 448, 7, 7, 2, 20, 0.25, 0.45);
+ * arma::field<arma::vec> detections;
+ * decoder.Decode(predictions, detections);
+ * @endcode
+ */
+class YOLODecoder
+{
+ public:
+  //! Create an empty decoder.
+  YOLODecoder() :
+      imageWidth(0),
+      imageHeight(0),
+      numBoxes(0),
+      numClasses(0),
+      scoreThreshold(0.25),
+      iouThreshold(0.45),
+      normalize(true)
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Create a decoder of YOLOv1 predictions.
+   *
+   * @param imageWidth Width of images given to the model.
+   * @param imageHeight Height of images given to the model.
+   * @param gridWidth Width of output feature map of YOLO model.
+   * @param gridHeight Height of output feature map of YOLO model.
+   * @param numBoxes Number of bounding boxes per grid.
+   * @param numClasses Number of classes.
+   * @param scoreThreshold Minimum score of a detection.
+   * @param iouThreshold Detections of a class whose IoU with a detection
+   *     with a higher score exceeds this are removed.
+   * @param normalize Whether centres are relative to their cell, as encoded
+   *     by YOLOPreProcessor() with normalize set to true.
+   */
+  YOLODecoder(const size_t imageWidth,
+              const size_t imageHeight,
+              const size_t gridWidth = 7,
+              const size_t gridHeight = 7,
+              const size_t numBoxes = 2,
+              const size_t numClasses = 20,
+              const double scoreThreshold = 0.25,
+              const double iouThreshold = 0.45,
+              const bool normalize = true) :
+      gridSizes(2, 1),
+      imageWidth(imageWidth),
+      imageHeight(imageHeight),
+      numBoxes(numBoxes),
+      numClasses(numClasses),
+      scoreThreshold(scoreThreshold),
+      iouThreshold(iouThreshold),
+      normalize(normalize)
+  {
+    gridSizes(0, 0) = gridWidth;
+    gridSizes(1, 0) = gridHeight;
+  }
+
+  /**
+   * Create a decoder of anchor-based YOLOv2 and YOLOv3 predictions.
+   *
+   * @param anchors Width and height of each anchor box in pixels, one anchor
+   *     per column. Anchors are grouped by scale, in the order of gridSizes.
+   * @param gridSizes Width and height of the output feature map of each
+   *     scale, one scale per column.
+   * @param imageWidth Width of images given to the model.
+   * @param imageHeight Height of images given to the model.
+   * @param numClasses Number of classes.
+   * @param scoreThreshold Minimum score of a detection.
+   * @param iouThreshold Detections of a class whose IoU with a detection
+   *     with a higher score exceeds this are removed.
+   */
+  YOLODecoder(const arma::mat& anchors,
+              const arma::umat& gridSizes,
+              const size_t imageWidth = 416,
+              const size_t imageHeight = 416,
+              const size_t numClasses = 80,
+              const double scoreThreshold = 0.25,
+              const double iouThreshold = 0.45) :
+      anchors(anchors),
+      gridSizes(gridSizes),
+      imageWidth(imageWidth),
+      imageHeight(imageHeight),
+      numBoxes(0),
+      numClasses(numClasses),
+      scoreThreshold(scoreThreshold),
+      iouThreshold(iouThreshold),
+      normalize(true)
+  {
+    if (anchors.n_rows != 2 || gridSizes.n_rows != 2 ||
+        gridSizes.n_cols == 0 || anchors.n_cols % gridSizes.n_cols != 0)
+    {
+      mlpack::Log::Fatal << "Anchors must have a width and a height, and an "
+          << "equal number of anchors per scale." << std::endl;
+    }
+
+    numBoxes = anchors.n_cols / gridSizes.n_cols;
+  }
+
+  /**
+   * Decodes predictions of a batch of images.
+   *
+   * @param predictions Predictions of the model, one image per column.
+   * @param detections Field where detections of each image are stored as
+   *     class, x1, y1, x2, y2, score, sorted by class and decreasing score.
+   */
+  template<typename eT>
+  void Decode(const arma::Mat<eT>& predictions,
+              arma::field<arma::vec>& detections) const
+  {
+    mlpack::Log::Assert(predictions.n_rows == OutputSize(),
+        "Number of rows doesn't match the size of predictions.");
+
+    detections.set_size(1, predictions.n_cols);
+
+    #pragma omp parallel
+    {
+      std::vector<Detection> candidates;
+      std::vector<double> x1, y1, x2, y2, area;
+      std::vector<char> suppressed;
+
+      #pragma omp for schedule(dynamic)
+      for (omp_size_t col = 0; col < (omp_size_t) predictions.n_cols; col++)
+      {
+        candidates.clear();
+        if (anchors.n_cols == 0)
+          GridCandidates(predictions.colptr(col), candidates);
+        else
+          AnchorCandidates(predictions.colptr(col), candidates);
+
+        std::sort(candidates.begin(), candidates.end(),
+            [](const Detection& a, const Detection& b)
+            {
+              return a.label < b.label ||
+                  (a.label == b.label && a.score > b.score);
+            });
+
+        const size_t n = candidates.size();
+        x1.resize(n);
+        y1.resize(n);
+        x2.resize(n);
+        y2.resize(n);
+        area.resize(n);
+        for (size_t i = 0; i < n; i++)
+        {
+          x1[i] = candidates[i].x1;
+          y1[i] = candidates[i].y1;
+          x2[i] = candidates[i].x2;
+          y2[i] = candidates[i].y2;
+          area[i] = (x2[i] - x1[i]) * (y2[i] - y1[i]);
+        }
+
+        // Suppress each class, from the candidate with the highest score.
+        suppressed.assign(n, 0);
+        size_t kept = 0;
+        for (size_t begin = 0, end = 0; begin < n; begin = end)
+        {
+          while (end < n && candidates[end].label == candidates[begin].label)
+            end++;
+
+          for (size_t i = begin; i < end; i++)
+          {
+            if (suppressed[i])
+              continue;
+
+            kept++;
+            Suppress(i, end, x1.data(), y1.data(), x2.data(), y2.data(),
+                area.data(), suppressed.data());
+          }
+        }
+
+        arma::vec& imageDetections = detections(0, col);
+        imageDetections.set_size(6 * kept);
+        for (size_t i = 0, k = 0; i < n; i++)
+        {
+          if (suppressed[i])
+            continue;
+
+          const Detection& d = candidates[i];
+          double* detection = imageDetections.memptr() + 6 * k++;
+          detection[0] = d.label;
+          detection[1] = d.x1;
+          detection[2] = d.y1;
+          detection[3] = d.x2;
+          detection[4] = d.y2;
+          detection[5] = d.score;
+        }
+      }
+    }
+  }
+
+  //! Get the number of rows of predictions of an image.
+  size_t OutputSize() const
+  {
+    const size_t predictions = (anchors.n_cols == 0) ? 5 * numBoxes +
+        numClasses : numBoxes * (5 + numClasses);
+    size_t size = 0;
+    for (size_t s = 0; s < gridSizes.n_cols; s++)
+      size += gridSizes(0, s) * gridSizes(1, s) * predictions;
+
+    return size;
+  }
+
+  //! Get the minimum score of a detection.
+  double ScoreThreshold() const { return scoreThreshold; }
+  //! Modify the minimum score of a detection.
+  double& ScoreThreshold() { return scoreThreshold; }
+
+  //! Get the IoU above which detections are suppressed.
+  double IoUThreshold() const { return iouThreshold; }
+  //! Modify the IoU above which detections are suppressed.
+  double& IoUThreshold() { return iouThreshold; }
+
+ private:
+  //! A candidate detection.
+  struct Detection
+  {
+    //! Class of the detection.
+    size_t label;
+
+    //! Corners of the box in pixels.
+    double x1, y1, x2, y2;
+
+    //! Score of the detection.
+    double score;
+  };
+
+  //! Adds candidates of YOLOv1 predictions of an image.
+  template<typename eT>
+  void GridCandidates(const eT* prediction,
+                      std::vector<Detection>& candidates) const
+  {
+    const size_t gridWidth = gridSizes(0, 0), gridHeight = gridSizes(1, 0);
+    const size_t cells = gridWidth * gridHeight;
+    for (size_t gridY = 0; gridY < gridHeight; gridY++)
+    {
+      for (size_t gridX = 0; gridX < gridWidth; gridX++)
+      {
+        // Same cell layout as YOLOPreProcessor().
+        const eT* cell = prediction + gridX + gridWidth * gridY;
+        for (size_t k = 0; k < numBoxes; k++)
+        {
+          const eT* box = cell + 5 * k * cells;
+          if (box[4 * cells] < scoreThreshold)
+            continue;
+
+          double centreX = box[0], centreY = box[cells];
+          if (normalize)
+          {
+            centreX = (gridX + centreX) / gridWidth;
+            centreY = (gridY + centreY) / gridHeight;
+          }
+
+          AddCandidates(cell + 5 * numBoxes * cells, cells, box[4 * cells],
+              centreX, centreY, box[2 * cells], box[3 * cells], candidates);
+        }
+      }
+    }
+  }
+
+  //! Adds candidates of anchor-based predictions of an image.
+  template<typename eT>
+  void AnchorCandidates(const eT* prediction,
+                        std::vector<Detection>& candidates) const
+  {
+    for (size_t s = 0; s < gridSizes.n_cols; s++)
+    {
+      const size_t gridWidth = gridSizes(0, s), gridHeight = gridSizes(1, s);
+      const size_t cells = gridWidth * gridHeight;
+      for (size_t a = 0; a < numBoxes; a++)
+      {
+        const size_t anchor = s * numBoxes + a;
+        const eT* slot = prediction + a * (5 + numClasses) * cells;
+        const eT* objectness = slot + 4 * cells;
+        for (size_t i = 0; i < cells; i++)
+        {
+          if (objectness[i] < scoreThreshold)
+            continue;
+
+          const eT* box = slot + i;
+          AddCandidates(box + 5 * cells, cells, objectness[i],
+              (i % gridWidth + box[0]) / gridWidth,
+              (i / gridWidth + box[cells]) / gridHeight,
+              anchors(0, anchor) * std::exp(box[2 * cells]) / imageWidth,
+              anchors(1, anchor) * std::exp(box[3 * cells]) / imageHeight,
+              candidates);
+        }
+      }
+
+      prediction += cells * numBoxes * (5 + numClasses);
+    }
+  }
+
+  //! Adds a candidate for each class of a box whose score reaches the
+  //! threshold. Coordinates are relative to the size of the image.
+  template<typename eT>
+  void AddCandidates(const eT* classes,
+                     const size_t stride,
+                     const double objectness,
+                     const double centreX,
+                     const double centreY,
+                     const double width,
+                     const double height,
+                     std::vector<Detection>& candidates) const
+  {
+    for (size_t c = 0; c < numClasses; c++)
+    {
+      const double score = objectness * classes[c * stride];
+      if (score < scoreThreshold)
+        continue;
+
+      Detection detection;
+      detection.label = c;
+      detection.x1 = (centreX - width / 2.0) * imageWidth;
+      detection.y1 = (centreY - height / 2.0) * imageHeight;
+      detection.x2 = (centreX + width / 2.0) * imageWidth;
+      detection.y2 = (centreY + height / 2.0) * imageHeight;
+      detection.score = score;
+      candidates.push_back(detection);
+    }
+  }
+
+  //! Suppresses candidates in (i, end) whose IoU with candidate i exceeds
+  //! the threshold.
+  void Suppress(const size_t i,
+                const size_t end,
+                const double* x1,
+                const double* y1,
+                const double* x2,
+                const double* y2,
+                const double* area,
+                char* suppressed) const
+  {
+    #pragma omp simd
+    for (size_t j = i + 1; j < end; j++)
+    {
+      const double width = std::max(std::min(x2[i], x2[j]) -
+          std::max(x1[i], x1[j]), 0.0);
+      const double height = std::max(std::min(y2[i], y2[j]) -
+          std::max(y1[i], y1[j]), 0.0);
+      const double intersection = width * height;
+      const double iou = intersection / std::max(area[i] + area[j] -
+          intersection, 1e-12);
+      suppressed[j] |= (char) (iou > iouThreshold);
+    }
+  }
+
+  //! Locally stored width and height of anchor boxes, empty for YOLOv1.
+  arma::mat anchors;
+
+  //! Locally stored width and height of the grid of each scale.
+  arma::umat gridSizes;
+
+  //! Locally stored size of images given to the model.
+  size_t imageWidth, imageHeight;
+
+  //! Locally stored number of boxes per cell of each scale.
+  size_t numBoxes;
+
+  //! Locally stored number of classes.
+  size_t numClasses;
+
+  //! Locally stored minimum score of a detection.
+  double scoreThreshold;
+
+  //! Locally stored IoU above which detections are suppressed.
+  double iouThreshold;
+
+  //! Locally stored whether YOLOv1 centres are relative to their cell.
+  bool normalize;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
@@ -25,6 +25,11 @@ YOLO<OutputLayerType, InitializationRuleType>::YOLO() :
     inputChannel(0),
     inputWidth(0),
     inputHeight(0),
+    imageWidth(0),
+    imageHeight(0),
+    poolWidth(0),
+    poolHeight(0),
+    includeTop(true),
     numClasses(0),
     numBoxes(0),
     featureWidth(0),
@@ -80,6 +85,11 @@ YOLO<OutputLayerType, InitializationRuleType>::YOLO(
     inputChannel(std::get<0>(inputShape)),
     inputWidth(std::get<1>(inputShape)),
     inputHeight(std::get<2>(inputShape)),
+    imageWidth(std::get<1>(inputShape)),
+    imageHeight(std::get<2>(inputShape)),
+    poolWidth(0),
+    poolHeight(0),
+    includeTop(includeTop),
     numClasses(numClasses),
     numBoxes(numBoxes),
     featureWidth(std::get<0>(featureShape)),
@@ -103,6 +113,82 @@ YOLO<OutputLayerType, InitializationRuleType>::YOLO(
     return;
   }
 
+  Build();
+}
+
+template<
+    typename OutputLayerType,
+    typename InitializationRuleType
+>
+void YOLO<
+    OutputLayerType, InitializationRuleType
+>::SetInputResolution(const size_t width, const size_t height)
+{
+  if (width == imageWidth && height == imageHeight)
+    return;
+
+  // Sizes of the pooling layers of a loaded model are found by building the
+  // model for the resolution it was created with.
+  if (poolWidth == 0)
+  {
+    ann::FFN<OutputLayerType, InitializationRuleType> loaded;
+    std::swap(loaded, yolo);
+    Build();
+    std::swap(loaded, yolo);
+  }
+
+  // The feature map is halved five times before the last pooling layer, which
+  // can't output more values than its input has.
+  if (std::ceil(width / 32.0) < poolWidth ||
+      std::ceil(height / 32.0) < poolHeight)
+  {
+    mlpack::Log::Fatal << "Input resolution " << width << " x " << height
+        << " is less than the minimum of " << 32 * (poolWidth - 1) + 1 << " x "
+        << 32 * (poolHeight - 1) + 1 << " for the resolution the model was "
+        << "created with." << std::endl;
+  }
+
+  std::vector<ann::BatchNorm<>*> layers;
+  BatchNormLayers(layers);
+  std::vector<arma::mat> means, variances;
+  for (size_t i = 0; i < layers.size(); i++)
+  {
+    means.push_back(layers[i]->TrainingMean());
+    variances.push_back(layers[i]->TrainingVariance());
+  }
+
+  const arma::mat parameters = yolo.Parameters();
+  yolo = ann::FFN<OutputLayerType, InitializationRuleType>();
+  imageWidth = width;
+  imageHeight = height;
+  Build();
+
+  // Convolutions and the top don't depend on the input resolution, so the
+  // layers have the same weights.
+  BatchNormLayers(layers);
+  if (yolo.Parameters().n_elem != parameters.n_elem ||
+      layers.size() != means.size())
+  {
+    mlpack::Log::Fatal << "Layers of the model don't match YOLO" << yoloVersion
+        << "." << std::endl;
+  }
+
+  yolo.Parameters() = parameters;
+  for (size_t i = 0; i < layers.size(); i++)
+  {
+    layers[i]->TrainingMean() = means[i];
+    layers[i]->TrainingVariance() = variances[i];
+  }
+}
+
+template<
+    typename OutputLayerType,
+    typename InitializationRuleType
+>
+void YOLO<OutputLayerType, InitializationRuleType>::Build()
+{
+  inputWidth = imageWidth;
+  inputHeight = imageHeight;
   if (yoloVersion == "v1-tiny")
   {
     yolo.Add(new ann::IdentityLayer<>());
@@ -116,10 +202,20 @@ YOLO<OutputLayerType, InitializationRuleType>::YOLO(
     for (size_t blockId = 0; blockId < numBlocks; blockId++)
     {
       ConvolutionBlock(outChannels, outChannels * 2, 3, 3, 1, 1, 1, 1, true);
-      PoolingBlock(2);
+
+      // The output of the last pooling layer keeps the size it had for the
+      // resolution the model was created with, so the top doesn't change.
+      if (blockId + 1 < numBlocks)
+        PoolingBlock(2);
+      else
+        PoolingBlock(2, "max", poolWidth, poolHeight);
+
       outChannels *= 2;
     }
 
+    poolWidth = inputWidth;
+    poolHeight = inputHeight;
+
     ConvolutionBlock(outChannels, outChannels * 2, 3, 3, 1, 1, 1, 1, true);
     outChannels *= 2;
     ConvolutionBlock(outChannels, 256, 3, 3, 1, 1, 1, 1, true);
@@ -136,6 +232,32 @@ YOLO<OutputLayerType, InitializationRuleType>::YOLO(
   }
 }
 
+template<
+    typename OutputLayerType,
+    typename InitializationRuleType
+>
+void YOLO<
+    OutputLayerType, InitializationRuleType
+>::BatchNormLayers(std::vector<ann::BatchNorm<>*>& layers)
+{
+  layers.clear();
+  for (size_t i = 0; i < yolo.Model().size(); i++)
+  {
+    ann::Sequential<>** block = boost::get<ann::Sequential<>*>(
+        &yolo.Model()[i]);
+    if (block == NULL)
+      continue;
+
+    for (size_t j = 0; j < (*block)->Model().size(); j++)
+    {
+      ann::BatchNorm<>** batchNorm = boost::get<ann::BatchNorm<>*>(
+          &(*block)->Model()[j]);
+      if (batchNorm != NULL)
+        layers.push_back(*batchNorm);
+    }
+  }
+}
+
 template<
     typename OutputLayerType,
     typename InitializationRuleType
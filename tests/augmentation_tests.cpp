@@ -10,6 +10,9 @@
  * http://www.opensource.org/licenses/BSD-3-Clause for more information.
  */
 #include <augmentation/augmentation.hpp>
+#include <augmentation/detection_augmentation.hpp>
+#include <augmentation/mix_augmentation.hpp>
+#include <augmentation/multi_scale_resize.hpp>
 #include "catch.hpp"
 
 using namespace mlpack::models;
@@ -51,3 +54,469 @@ TEST_CASE("ResizeAugmentationTest", "[AugmentationTest]")
   REQUIRE(input.n_cols == 2);
   REQUIRE(input.n_rows == 8 * 8);
 }
+
+TEST_CASE("FlipAugmentationTest", "[AugmentationTest]")
+{
+  // Two 3 x 2 images with 2 channels.
+  const size_t width = 3, height = 2, depth = 2;
+  arma::mat input = arma::reshape(arma::regspace(0, 23), 12, 2);
+
+  // With probability 1 every image is flipped.
+  Augmentation horizontalFlip(std::vector<std::string>(1, "horizontal-flip"),
+      1.0);
+  arma::mat output = input;
+  horizontalFlip.Transform(output, width, height, depth);
+
+  for (size_t col = 0; col < 2; col++)
+  {
+    for (size_t y = 0; y < height; y++)
+    {
+      for (size_t x = 0; x < width; x++)
+      {
+        for (size_t c = 0; c < depth; c++)
+        {
+          REQUIRE(output((y * width + x) * depth + c, col) ==
+              input((y * width + width - 1 - x) * depth + c, col));
+        }
+      }
+    }
+  }
+
+  // Flipping twice gives the original images.
+  horizontalFlip.Transform(output, width, height, depth);
+  REQUIRE(arma::approx_equal(output, input, "absdiff", 0.0));
+
+  Augmentation verticalFlip(std::vector<std::string>(1, "vertical-flip"),
+      1.0);
+  verticalFlip.Transform(output, width, height, depth);
+  REQUIRE(arma::approx_equal(output.rows(0, 5), input.rows(6, 11), "absdiff",
+      0.0));
+  REQUIRE(arma::approx_equal(output.rows(6, 11), input.rows(0, 5), "absdiff",
+      0.0));
+
+  // With probability 0 no image is changed.
+  Augmentation never(std::vector<std::string>(1, "vertical-flip"), 0.0);
+  output = input;
+  never.Transform(output, width, height, depth);
+  REQUIRE(arma::approx_equal(output, input, "absdiff", 0.0));
+}
+
+TEST_CASE("GeometricAugmentationTest", "[AugmentationTest]")
+{
+  const size_t width = 8, height = 8, depth = 3;
+  arma::Mat<unsigned char> input = arma::randi<arma::Mat<unsigned char>>(
+      width * height * depth, 16, arma::distr_param(1, 255));
+
+  // Rotations by multiples of 90 degrees move pixels without changing them.
+  Augmentation rotate90(std::vector<std::string>(1, "rotate-90"), 1.0);
+  arma::Mat<unsigned char> output = input;
+  rotate90.Transform(output, width, height, depth);
+  for (size_t col = 0; col < input.n_cols; col++)
+  {
+    REQUIRE(arma::accu(output.col(col) != input.col(col)) > 0);
+    REQUIRE(arma::all(arma::sort(output.col(col)) ==
+        arma::sort(input.col(col))));
+  }
+
+  // Cutout sets at most 2 x 2 pixels to zero, and at least one pixel.
+  Augmentation cutout(std::vector<std::string>(1, "cutout (2)"), 1.0);
+  output = input;
+  cutout.Transform(output, width, height, depth);
+  for (size_t col = 0; col < input.n_cols; col++)
+  {
+    const size_t zeros = arma::accu(output.col(col) == 0);
+    REQUIRE(zeros >= depth);
+    REQUIRE(zeros <= 4 * depth);
+  }
+
+  // Shape doesn't change for other augmentations.
+  std::vector<std::string> augmentations = {"random-crop (2)", "rotate (10)",
+      "resize (6, 6)"};
+  Augmentation augmentation(augmentations, 0.5);
+  output = input;
+  augmentation.Transform(output, width, height, depth);
+  REQUIRE(output.n_rows == 6 * 6 * depth);
+  REQUIRE(output.n_cols == input.n_cols);
+}
+
+TEST_CASE("AugmentationPipelineTest", "[AugmentationTest]")
+{
+  // Two 4 x 3 images with 2 channels.
+  const size_t width = 4, height = 3, depth = 2;
+  arma::mat input = arma::reshape(arma::regspace(0, 47), 24, 2);
+
+  // Resize without flips keeps the corners of the image.
+  AugmentationPipeline resize({"resize (8, 6)"}, 1.0, width, height, depth);
+  REQUIRE(resize.OutputWidth() == 8);
+  REQUIRE(resize.OutputHeight() == 6);
+
+  arma::mat resized;
+  resize.Apply(input, resized);
+  REQUIRE(resized.n_rows == 8 * 6 * depth);
+  REQUIRE(resized.n_cols == 2);
+  REQUIRE(resized(0, 0) == Approx(input(0, 0)));
+  REQUIRE(resized(1, 1) == Approx(input(1, 1)));
+
+  // Flip, normalize and channel order are fused with the resize.
+  AugmentationPipeline pipeline({"resize (8, 6)", "vertical-flip",
+      "normalize (1, 2)", "channel-order (1, 0)"}, 1.0, width, height, depth);
+  arma::mat output;
+  pipeline.Apply(input, output);
+  REQUIRE(output.n_rows == resized.n_rows);
+  for (size_t col = 0; col < 2; col++)
+  {
+    for (size_t y = 0; y < 6; y++)
+    {
+      for (size_t x = 0; x < 8; x++)
+      {
+        for (size_t c = 0; c < depth; c++)
+        {
+          const double expected = (resized(((5 - y) * 8 + x) * depth + 1 - c,
+              col) - 1) / 2;
+          REQUIRE(output((y * 8 + x) * depth + c, col) ==
+              Approx(expected).margin(1e-10));
+        }
+      }
+    }
+  }
+
+  // Augmentation::Transform() gives the same result as the pipeline.
+  std::vector<std::string> augmentations = {"resize (8, 6)",
+      "horizontal-flip"};
+  AugmentationPipeline flip(augmentations, 1.0, width, height, depth);
+  flip.Apply(input, output);
+  Augmentation augmentation(augmentations, 1.0);
+  arma::mat transformed = input;
+  augmentation.Transform(transformed, width, height, depth);
+  REQUIRE(arma::approx_equal(output, transformed, "absdiff", 1e-10));
+
+  // Channel order must be a permutation.
+  REQUIRE_THROWS_AS(AugmentationPipeline({"channel-order (0, 0)"}, 1.0,
+      width, height, depth), std::runtime_error);
+}
+
+TEST_CASE("BilinearResizeTest", "[AugmentationTest]")
+{
+  // Two 5 x 7 images with 3 channels.
+  const size_t width = 5, height = 7, depth = 3;
+  const size_t outputWidth = 8, outputHeight = 4;
+  arma::mat input = arma::randu<arma::mat>(width * height * depth, 2) * 255;
+
+  BilinearResize resize(width, height, outputWidth, outputHeight, depth);
+  arma::mat output;
+  resize.Apply(input, output);
+  REQUIRE(output.n_rows == outputWidth * outputHeight * depth);
+  REQUIRE(output.n_cols == 2);
+
+  // Compare with bilinear interpolation of each pixel, sampled like
+  // mlpack::ann::BilinearInterpolation.
+  const double scaleX = (double) width / outputWidth;
+  const double scaleY = (double) height / outputHeight;
+  for (size_t col = 0; col < 2; col++)
+  {
+    for (size_t y = 0; y < outputHeight; y++)
+    {
+      const size_t y0 = std::min((size_t) (y * scaleY), height - 2);
+      const double dy = std::min(y * scaleY - y0, 1.0);
+      for (size_t x = 0; x < outputWidth; x++)
+      {
+        const size_t x0 = std::min((size_t) (x * scaleX), width - 2);
+        const double dx = std::min(x * scaleX - x0, 1.0);
+        for (size_t c = 0; c < depth; c++)
+        {
+          const double expected =
+              input((y0 * width + x0) * depth + c, col) * (1 - dx) * (1 - dy) +
+              input((y0 * width + x0 + 1) * depth + c, col) * dx * (1 - dy) +
+              input(((y0 + 1) * width + x0) * depth + c, col) * (1 - dx) * dy +
+              input(((y0 + 1) * width + x0 + 1) * depth + c, col) * dx * dy;
+          REQUIRE(output((y * outputWidth + x) * depth + c, col) ==
+              Approx(expected).margin(1e-8));
+        }
+      }
+    }
+  }
+
+  // Resizing in place gives the same images, whether columns shrink or grow.
+  arma::mat inPlace = input;
+  resize.Apply(inPlace);
+  REQUIRE(arma::approx_equal(inPlace, output, "absdiff", 1e-10));
+
+  BilinearResize upscale(width, height, 2 * width, 2 * height, depth);
+  upscale.Apply(input, output);
+  inPlace = input;
+  upscale.Apply(inPlace);
+  REQUIRE(inPlace.n_rows == 4 * width * height * depth);
+  REQUIRE(arma::approx_equal(inPlace, output, "absdiff", 1e-10));
+
+  // 8-bit images are rounded to the nearest value.
+  arma::Mat<unsigned char> bytes = arma::conv_to<arma::Mat<unsigned char>>::
+      from(arma::round(input));
+  arma::mat rounded = arma::conv_to<arma::mat>::from(bytes);
+  resize.Apply(bytes);
+  resize.Apply(rounded);
+  REQUIRE(arma::approx_equal(arma::conv_to<arma::mat>::from(bytes),
+      arma::round(rounded), "absdiff", 1.0));
+
+  // Resizing to the same size doesn't change images.
+  BilinearResize identity(width, height, width, height, depth);
+  identity.Apply(input, output);
+  REQUIRE(arma::approx_equal(output, input, "absdiff", 1e-10));
+}
+
+TEST_CASE("LetterboxResizeTest", "[AugmentationTest]")
+{
+  // Two 8 x 4 images with 2 channels, fitted into 4 x 4 images.
+  const size_t width = 8, height = 4, depth = 2;
+  arma::mat input = arma::randu<arma::mat>(width * height * depth, 2);
+
+  const BilinearResize letterbox = BilinearResize::Letterbox(width, height, 4,
+      4, depth, 0.5);
+  REQUIRE(letterbox.ScaleX() == Approx(0.5));
+  REQUIRE(letterbox.ScaleY() == Approx(0.5));
+  REQUIRE(letterbox.OffsetX() == 0);
+  REQUIRE(letterbox.OffsetY() == 1);
+  REQUIRE(letterbox.ToSourceX(letterbox.ToOutputX(5.0)) == Approx(5.0));
+  REQUIRE(letterbox.ToSourceY(letterbox.ToOutputY(3.0)) == Approx(3.0));
+
+  arma::mat output;
+  letterbox.Apply(input, output);
+  REQUIRE(output.n_rows == 4 * 4 * depth);
+
+  // Rows 1 and 2 hold the image scaled uniformly, rows 0 and 3 are padding.
+  arma::mat resized;
+  BilinearResize(width, height, 4, 2, depth).Apply(input, resized);
+  const size_t rowSize = 4 * depth;
+  for (size_t col = 0; col < 2; col++)
+  {
+    REQUIRE(arma::all(output.col(col).head(rowSize) == 0.5));
+    REQUIRE(arma::all(output.col(col).tail(rowSize) == 0.5));
+    REQUIRE(arma::approx_equal(output.col(col).subvec(rowSize,
+        3 * rowSize - 1), resized.col(col), "absdiff", 1e-10));
+  }
+
+  // The same letterbox is applied by Augmentation and fused with flips in
+  // AugmentationPipeline.
+  Augmentation augmentation({"letterbox (4, 4, 0.5)"}, 0.0);
+  arma::mat transformed = input;
+  augmentation.ResizeTransform(transformed, width, height, depth,
+      "letterbox (4, 4, 0.5)");
+  REQUIRE(arma::approx_equal(transformed, output, "absdiff", 1e-10));
+
+  AugmentationPipeline pipeline({"letterbox (4, 4, 0.5)", "vertical-flip"},
+      1.0, width, height, depth);
+  pipeline.Apply(input, transformed);
+  for (size_t y = 0; y < 4; y++)
+  {
+    REQUIRE(arma::approx_equal(transformed.rows(y * rowSize,
+        (y + 1) * rowSize - 1), output.rows((3 - y) * rowSize,
+        (4 - y) * rowSize - 1), "absdiff", 1e-10));
+  }
+}
+
+TEST_CASE("PhotometricAugmentationTest", "[AugmentationTest]")
+{
+  typedef AugmentationKernels<double> Kernels;
+  const size_t width = 6, height = 5, depth = 3, pixels = width * height;
+  const arma::mat input = arma::round(arma::randu<arma::mat>(
+      pixels * depth, 1) * 255);
+  std::mt19937 generator(3);
+
+  // Gray images don't change with hue or saturation.
+  arma::mat gray = arma::repmat(arma::regspace<arma::vec>(0, pixels - 1).t(),
+      depth, 1);
+  gray.reshape(pixels * depth, 1);
+  arma::mat image = gray;
+  Kernels::Hue(image.memptr(), width, height, depth, {0.5}, generator,
+      nullptr);
+  Kernels::Saturation(image.memptr(), width, height, depth, {0.9}, generator,
+      nullptr);
+  REQUIRE(arma::approx_equal(image, gray, "absdiff", 1e-8));
+
+  // Grayscale sets every channel to the luma of the pixel.
+  image = input;
+  Kernels::Grayscale(image.memptr(), width, height, depth, {}, generator,
+      nullptr);
+  for (size_t p = 0; p < pixels; p++)
+  {
+    const double luma = 0.299 * input(p * depth) + 0.587 *
+        input(p * depth + 1) + 0.114 * input(p * depth + 2);
+    for (size_t c = 0; c < depth; c++)
+      REQUIRE(image(p * depth + c) == Approx(luma));
+  }
+
+  // Planar images give the same result as interleaved images.
+  image = input;
+  arma::mat planar = arma::vectorise(arma::reshape(input, depth, pixels).t());
+  std::mt19937 first(7), second(7);
+  Kernels::Jitter(image.memptr(), pixels, depth, false, 0.3, 0.3, 0.3, 0.1,
+      first);
+  Kernels::Jitter(planar.memptr(), pixels, depth, true, 0.3, 0.3, 0.3, 0.1,
+      second);
+  REQUIRE(arma::approx_equal(arma::vectorise(arma::reshape(planar, pixels,
+      depth).t()), image, "absdiff", 1e-8));
+
+  // 8-bit images are rounded and clamped.
+  arma::Mat<unsigned char> bytes = arma::conv_to<arma::Mat<unsigned char>>::
+      from(input);
+  image = input;
+  first.seed(11);
+  second.seed(11);
+  Kernels::ColorJitter(image.memptr(), width, height, depth,
+      {0.8, 0.8, 0.8, 0.2}, first, nullptr);
+  AugmentationKernels<unsigned char>::ColorJitter(bytes.memptr(), width,
+      height, depth, {0.8, 0.8, 0.8, 0.2}, second, nullptr);
+  REQUIRE(arma::approx_equal(arma::conv_to<arma::mat>::from(bytes),
+      arma::clamp(arma::round(image), 0, 255), "absdiff", 1.0));
+}
+
+TEST_CASE("DetectionAugmentationTest", "[AugmentationTest]")
+{
+  // Two 8 x 6 images with 2 channels, each with two boxes.
+  const size_t width = 8, height = 6, depth = 2;
+  arma::mat input = arma::randu<arma::mat>(width * height * depth, 2);
+  arma::field<arma::vec> labels(1, 2);
+  labels(0, 0) = arma::vec({1, 1, 1, 3, 4, 2, 6, 0, 8, 1});
+  labels(0, 1) = labels(0, 0);
+
+  // Flips move the images and their boxes together.
+  DetectionAugmentation flip(std::vector<std::string>(1, "horizontal-flip"),
+      1.0, width, height, depth);
+  arma::mat output = input;
+  flip.Apply(output, labels);
+  for (size_t col = 0; col < 2; col++)
+  {
+    for (size_t y = 0; y < height; y++)
+    {
+      for (size_t x = 0; x < width; x++)
+      {
+        for (size_t c = 0; c < depth; c++)
+        {
+          REQUIRE(output((y * width + x) * depth + c, col) == Approx(
+              input((y * width + width - 1 - x) * depth + c, col)));
+        }
+      }
+    }
+
+    REQUIRE(arma::approx_equal(labels(0, col),
+        arma::vec({1, 5, 1, 7, 4, 2, 0, 0, 2, 1}), "absdiff", 1e-10));
+  }
+
+  // Boxes stay inside of the image and boxes that are too small are dropped.
+  DetectionAugmentation augmentation({"random-resized-crop (0.3)",
+      "scale-jitter (0.5, 1.5)", "translate (0.4)"}, 1.0, width, height,
+      depth, 2.0);
+  for (size_t i = 0; i < 10; i++)
+  {
+    augmentation.Apply(output, labels);
+    for (size_t col = 0; col < 2; col++)
+    {
+      const arma::vec& boxes = labels(0, col);
+      REQUIRE(boxes.n_elem % 5 == 0);
+      for (size_t j = 0; j < boxes.n_elem; j += 5)
+      {
+        REQUIRE(boxes(j + 1) >= 0);
+        REQUIRE(boxes(j + 2) >= 0);
+        REQUIRE(boxes(j + 3) <= width);
+        REQUIRE(boxes(j + 4) <= height);
+        REQUIRE((boxes(j + 3) - boxes(j + 1)) * (boxes(j + 4) - boxes(j + 2))
+            >= 2.0);
+      }
+    }
+  }
+
+  // Augmentations that can't move boxes aren't accepted, and the crop of
+  // Augmentation, whose parameter is a pad in pixels, isn't mistaken for a
+  // resized crop.
+  REQUIRE(DetectionAugmentation::Supports("random-resized-crop (0.5)"));
+  REQUIRE(!DetectionAugmentation::Supports("random-crop (4)"));
+  REQUIRE(!DetectionAugmentation::Supports("rotate (10)"));
+  REQUIRE_THROWS_AS(DetectionAugmentation({"random-resized-crop (4)"}, 1.0,
+      width, height, depth), std::runtime_error);
+}
+
+TEST_CASE("MixAugmentationTest", "[AugmentationTest]")
+{
+  // Six 4 x 3 images with 2 channels and 3 classes.
+  const size_t width = 4, height = 3, depth = 2, numClasses = 3;
+  const arma::mat input = arma::randu<arma::mat>(width * height * depth, 6);
+  const arma::mat labels = {{0, 1, 2, 0, 1, 2}};
+
+  for (const std::string augmentation : {"mixup (0.4)", "cutmix (1.0)"})
+  {
+    REQUIRE(MixAugmentation::Supports(augmentation));
+    MixAugmentation mix({augmentation}, 1.0, width, height, depth,
+        numClasses);
+
+    arma::mat features = input, targets;
+    mix.Apply(features, labels, targets, 5);
+    REQUIRE(targets.n_rows == numClasses);
+    REQUIRE(targets.n_cols == 6);
+
+    // Pairs of images exchange pixels and labels, so sums over the batch
+    // don't change.
+    REQUIRE(arma::approx_equal(arma::sum(features, 1), arma::sum(input, 1),
+        "absdiff", 1e-8));
+    REQUIRE(arma::approx_equal(arma::sum(targets, 0),
+        arma::ones<arma::rowvec>(6), "absdiff", 1e-8));
+    REQUIRE(arma::approx_equal(arma::sum(targets, 1),
+        2 * arma::ones<arma::vec>(numClasses), "absdiff", 1e-8));
+    REQUIRE(!arma::approx_equal(features, input, "absdiff", 1e-8));
+
+    // Each mixed image is a combination of its own image and one other
+    // image, weighted like its soft label.
+    for (size_t i = 0; i < 6; i++)
+    {
+      const double own = targets((size_t) labels(i), i);
+      REQUIRE(own >= 0.0);
+      REQUIRE(own <= 1.0);
+    }
+
+    // Batches are reproducible from the seed, and soft labels can be mixed
+    // again in place.
+    arma::mat repeated = input;
+    arma::mat soft;
+    mix.Apply(repeated, labels, soft, 5);
+    REQUIRE(arma::approx_equal(repeated, features, "absdiff", 1e-12));
+    REQUIRE(arma::approx_equal(soft, targets, "absdiff", 1e-12));
+    mix.Apply(repeated, soft, soft, 6);
+    REQUIRE(arma::approx_equal(arma::sum(soft, 0),
+        arma::ones<arma::rowvec>(6), "absdiff", 1e-8));
+  }
+}
+
+TEST_CASE("MultiScaleResizeTest", "[AugmentationTest]")
+{
+  // Two 8 x 8 images with 3 channels and a box each.
+  const size_t width = 8, height = 8, depth = 3;
+  const arma::mat input = arma::randu<arma::mat>(width * height * depth, 2);
+  arma::field<arma::vec> boxes(1, 2);
+  boxes(0, 0) = arma::vec({1, 2, 2, 6, 4});
+  boxes(0, 1) = arma::vec({0, 0, 0, 8, 8});
+
+  MultiScaleResize multiScale({4, 8, 12, 16}, 3, width, height, depth, 9);
+
+  // The resolution changes at most every 3 batches.
+  for (size_t batch = 0; batch < 30; batch++)
+  {
+    REQUIRE(multiScale.Width(batch) == multiScale.Width(batch - batch % 3));
+    REQUIRE(multiScale.Width(batch) == multiScale.Height(batch));
+  }
+
+  for (size_t batch = 0; batch < 30; batch += 3)
+  {
+    arma::mat images = input;
+    arma::field<arma::vec> scaledBoxes = boxes;
+    multiScale.Apply(images, scaledBoxes, batch);
+
+    const size_t size = multiScale.Width(batch);
+    arma::mat expected;
+    BilinearResize(width, height, size, size, depth).Apply(input, expected);
+    REQUIRE(arma::approx_equal(images, expected, "absdiff", 1e-10));
+
+    const double scale = (double) size / width;
+    REQUIRE(arma::approx_equal(scaledBoxes(0, 0), arma::vec({1, 2 * scale,
+        2 * scale, 6 * scale, 4 * scale}), "absdiff", 1e-10));
+    REQUIRE(arma::approx_equal(scaledBoxes(0, 1), arma::vec({0, 0, 0,
+        8 * scale, 8 * scale}), "absdiff", 1e-10));
+  }
+}
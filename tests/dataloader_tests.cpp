@@ -10,6 +10,7 @@
  * http://www.opensource.org/licenses/BSD-3-Clause for more information.
  */
 #include <dataloader/dataloader.hpp>
+#include <dataloader/batch_prefetcher.hpp>
 #include "catch.hpp"
 
 using namespace mlpack::models;
@@ -51,6 +52,142 @@ TEST_CASE("CSVDataLoaderTest", "[DataLoadersTest]")
   Utils::RemoveFile("./../data/iris.csv");
 }
 
+/**
+ * Check that CSV files parsed in parallel chunks match data::Load() and that
+ * only the requested fields are stored.
+ */
+TEST_CASE("ChunkedCSVLoadingTest", "[DataLoadersTest]")
+{
+  arma::mat dataset(5, 1000, arma::fill::randn);
+  dataset.row(4) = arma::floor(arma::abs(dataset.row(4)) * 3);
+  mlpack::data::Save("./../data/chunked_test.csv", dataset, true);
+
+  arma::mat expected;
+  mlpack::data::Load("./../data/chunked_test.csv", expected, true);
+
+  // Small chunks make sure lines are split between many threads.
+  CSVReader reader(64);
+  REQUIRE(reader.Open("./../data/chunked_test.csv"));
+  REQUIRE(reader.Rows() == 1000);
+  REQUIRE(reader.Cols() == 5);
+
+  // Store the lines in reverse order, the last 200 in the second set.
+  const arma::uvec columns = arma::linspace<arma::uvec>(999, 0, 1000);
+  arma::mat features, labels, secondFeatures, secondLabels;
+  reader.Read(columns, 800, 1, 3, 4, 4, features, labels, secondFeatures,
+      secondLabels);
+
+  REQUIRE(features.n_rows == 3);
+  REQUIRE(features.n_cols == 800);
+  REQUIRE(secondFeatures.n_cols == 200);
+  REQUIRE(labels.n_rows == 1);
+  for (size_t i = 0; i < 1000; i++)
+  {
+    const size_t col = 999 - i;
+    const arma::mat& setFeatures = col < 800 ? features : secondFeatures;
+    const arma::mat& setLabels = col < 800 ? labels : secondLabels;
+    const size_t setCol = col < 800 ? col : col - 800;
+    REQUIRE(arma::approx_equal(setFeatures.col(setCol),
+        expected.submat(1, i, 3, i), "absdiff", 0.0));
+    REQUIRE(setLabels(0, setCol) == expected(4, i));
+  }
+
+  // Without shuffling, the dataloader keeps the order of the file.
+  DataLoader<> dataloader;
+  dataloader.NumThreads() = 2;
+  dataloader.LoadCSV("./../data/chunked_test.csv", true, false, 0.2, false, 0,
+      3, -1, -1);
+  REQUIRE(arma::approx_equal(dataloader.TrainFeatures(),
+      expected.submat(0, 0, 3, 799), "absdiff", 0.0));
+  REQUIRE(arma::approx_equal(dataloader.ValidLabels(),
+      expected.submat(4, 800, 4, 999), "absdiff", 0.0));
+
+  Utils::RemoveFile("./../data/chunked_test.csv");
+}
+
+/**
+ * Check that shards of a dataset are disjoint and cover the dataset.
+ */
+TEST_CASE("ShardedCSVLoadingTest", "[DataLoadersTest]")
+{
+  arma::mat dataset(3, 101, arma::fill::randu);
+  dataset.row(0) = arma::regspace<arma::rowvec>(0, 100);
+  mlpack::data::Save("./../data/sharded_test.csv", dataset, true);
+
+  const size_t worldSize = 3;
+  arma::rowvec ids;
+  for (size_t rank = 0; rank < worldSize; rank++)
+  {
+    DataLoader<> dataloader;
+    dataloader.Shard(rank, worldSize, 7);
+    REQUIRE(dataloader.Rank() == rank);
+    REQUIRE(dataloader.WorldSize() == worldSize);
+
+    dataloader.LoadCSV("./../data/sharded_test.csv", true, true, 0.25, false,
+        0, 1, 2, 2);
+
+    // Shards differ by at most one data point.
+    const size_t shardSize = dataloader.TrainSize() + dataloader.ValidSize();
+    REQUIRE((shardSize == 33 || shardSize == 34));
+    REQUIRE(dataloader.ValidSize() == shardSize / 4);
+
+    ids = arma::join_rows(ids, dataloader.TrainFeatures().row(0));
+    ids = arma::join_rows(ids, dataloader.ValidFeatures().row(0));
+
+    // The same seed gives the same shard.
+    DataLoader<> other;
+    other.Shard(rank, worldSize, 7);
+    other.LoadCSV("./../data/sharded_test.csv", false, false, 0.0, false, 0,
+        0);
+    REQUIRE(other.TestFeatures().n_cols == shardSize);
+    REQUIRE(arma::approx_equal(arma::sort(other.TestFeatures().row(0)),
+        arma::sort(arma::join_rows(dataloader.TrainFeatures().row(0),
+        dataloader.ValidFeatures().row(0))), "absdiff", 0.0));
+  }
+
+  // Every data point is in exactly one shard.
+  REQUIRE(arma::approx_equal(arma::sort(ids),
+      arma::regspace<arma::rowvec>(0, 100), "absdiff", 0.0));
+
+  Utils::RemoveFile("./../data/sharded_test.csv");
+}
+
+/**
+ * Check that accessors don't copy datasets and Release functions move them
+ * out of the dataloader.
+ */
+TEST_CASE("DataLoaderReleaseTest", "[DataLoadersTest]")
+{
+  Utils::DownloadFile("/datasets/iris.csv", "./../data/iris.csv");
+
+  DataLoader<> irisDataloader;
+  irisDataloader.LoadCSV("./../data/iris.csv", true, true, 0.5, false, 0, -1,
+      1, -1);
+
+  const DataLoader<>& constDataloader = irisDataloader;
+  const double* trainFeatures = irisDataloader.TrainFeatures().memptr();
+  const double* validLabels = irisDataloader.ValidLabels().memptr();
+
+  // Const accessors and tuples must refer to the stored datasets.
+  REQUIRE(constDataloader.TrainFeatures().memptr() == trainFeatures);
+  REQUIRE(std::get<0>(constDataloader.TrainSet()).memptr() == trainFeatures);
+  REQUIRE(std::get<1>(constDataloader.ValidSet()).memptr() == validLabels);
+
+  // Released datasets must keep their memory.
+  arma::mat trainX, trainY;
+  std::tie(trainX, trainY) = irisDataloader.ReleaseTrainSet();
+  REQUIRE(trainX.memptr() == trainFeatures);
+  REQUIRE(trainX.n_cols == 75);
+  REQUIRE(trainY.n_cols == 75);
+  REQUIRE(irisDataloader.TrainFeatures().n_elem == 0);
+  REQUIRE(irisDataloader.TrainLabels().n_elem == 0);
+
+  // Other sets aren't affected.
+  REQUIRE(irisDataloader.ValidFeatures().n_cols == 75);
+
+  Utils::RemoveFile("./../data/iris.csv");
+}
+
 /**
  * Simple test for MNIST Dataloader.
  */
@@ -224,6 +361,68 @@ TEST_CASE("ObjectDetectionDataLoaderMatTypeTest", "[DataLoadersTest]")
   REQUIRE(dataloader.ValidFeatures().n_cols == 1);
 }
 
+/**
+ * Test parsing annotations with custom tag names, comments, unknown classes
+ * and entities.
+ */
+TEST_CASE("AnnotationParserTest", "[DataLoadersTest]")
+{
+  std::ofstream file("./../data/annotation_parser_test.xml");
+  file << "<?xml version=\"1.0\"?>\n"
+       << "<!-- Custom tags. -->\n"
+       << "<label>\n"
+       << "  <image> cat &amp; dog.jpg </image>\n"
+       << "  <size><width>500</width><height>375</height>"
+       << "<depth>3</depth></size>\n"
+       << "  <segmented />\n"
+       << "  <item>\n"
+       << "    <name>cat</name>\n"
+       << "    <box><xmin>10</xmin><ymin>20.7</ymin><xmax>30</xmax>"
+       << "<ymax>40</ymax></box>\n"
+       << "  </item>\n"
+       << "  <item>\n"
+       << "    <name>person</name>\n"
+       << "    <box><xmin>1</xmin><ymin>2</ymin><xmax>3</xmax>"
+       << "<ymax>4</ymax></box>\n"
+       << "  </item>\n"
+       << "  <item>\n"
+       << "    <box><xmin>50</xmin><ymin>60</ymin><xmax>70</xmax>"
+       << "<ymax>80</ymax></box>\n"
+       << "    <name>dog</name>\n"
+       << "  </item>\n"
+       << "</label>\n";
+  file.close();
+
+  AnnotationParser parser({"cat", "dog"}, "label", "image", "size", "item",
+      "box");
+  Annotation annotation;
+  std::vector<double> buffer(5, -1.0);
+  REQUIRE(parser.Parse("./../data/annotation_parser_test.xml", annotation,
+      buffer));
+
+  REQUIRE(annotation.imageName == "cat & dog.jpg");
+  REQUIRE(annotation.width == 500);
+  REQUIRE(annotation.height == 375);
+  REQUIRE(annotation.depth == 3);
+
+  // Objects of unknown classes are skipped and the remaining ones are
+  // appended to the buffer in reverse order.
+  const std::vector<double> boxes = {-1, -1, -1, -1, -1, 1, 50, 60, 70, 80,
+      0, 10, 20, 30, 40};
+  REQUIRE(annotation.boxOffset == 5);
+  REQUIRE(annotation.numBoxes == 2);
+  REQUIRE(buffer == boxes);
+
+  // Files without the base tag aren't annotations.
+  REQUIRE(!parser.ParseString("<annotation><object><name>cat</name>"
+      "</object></annotation>", annotation, buffer));
+  REQUIRE(!parser.Parse("./../data/missing_annotation.xml", annotation,
+      buffer));
+  REQUIRE(buffer == boxes);
+
+  Utils::RemoveFile("./../data/annotation_parser_test.xml");
+}
+
 TEST_CASE("LoadImageDatasetFromDirectoryTest", "[DataLoadersTest]")
 {
   // Download the test dataset.
@@ -250,3 +449,310 @@ TEST_CASE("LoadImageDatasetFromDirectoryTest", "[DataLoadersTest]")
   REQUIRE(dataloader.ValidLabels().n_cols == 200);
   REQUIRE(dataloader.ValidLabels().n_rows == 1);
 }
+
+/**
+ * Check that features and labels stay aligned when an image dataset is split.
+ */
+TEST_CASE("ImageDatasetSplitTest", "[DataLoadersTest]")
+{
+  // Download the test dataset.
+  Utils::DownloadFile("/datasets/cifar-test.tar.gz",
+    "./../data/cifar-test.tar.gz", "", false, true,
+    "www.mlpack.org", true);
+
+  DataLoader<> dataloader, orderedDataloader, shuffledDataloader;
+  dataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, false);
+  orderedDataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, true, 0.2, false);
+  shuffledDataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, true, 0.2, true);
+
+  const arma::mat& features = dataloader.TestFeatures();
+  const arma::mat& labels = dataloader.TestLabels();
+
+  // Without shuffling, the split keeps the order of images.
+  REQUIRE(arma::approx_equal(orderedDataloader.TrainFeatures(),
+      features.cols(0, 799), "absdiff", 0.0));
+  REQUIRE(arma::approx_equal(orderedDataloader.TrainLabels(),
+      labels.cols(0, 799), "absdiff", 0.0));
+  REQUIRE(arma::approx_equal(orderedDataloader.ValidFeatures(),
+      features.cols(800, 999), "absdiff", 0.0));
+  REQUIRE(arma::approx_equal(orderedDataloader.ValidLabels(),
+      labels.cols(800, 999), "absdiff", 0.0));
+
+  // With shuffling, every image must keep its label.
+  const arma::rowvec sums = arma::sum(features);
+  const arma::mat& trainFeatures = shuffledDataloader.TrainFeatures();
+  const arma::mat& trainLabels = shuffledDataloader.TrainLabels();
+  REQUIRE(trainFeatures.n_cols == 800);
+  for (size_t i = 0; i < trainFeatures.n_cols; i++)
+  {
+    const arma::uvec matches = arma::find(sums ==
+        arma::accu(trainFeatures.col(i)));
+    REQUIRE(arma::accu(labels.cols(matches) == trainLabels(0, i)) > 0);
+  }
+}
+
+/**
+ * Check that images decoded in parallel are identical to images decoded
+ * by a single thread.
+ */
+TEST_CASE("ParallelImageLoadingTest", "[DataLoadersTest]")
+{
+  // Download the test dataset.
+  Utils::DownloadFile("/datasets/cifar-test.tar.gz",
+    "./../data/cifar-test.tar.gz", "", false, true,
+    "www.mlpack.org", true);
+
+  DataLoader<> serialDataloader, parallelDataloader;
+  serialDataloader.NumThreads() = 1;
+  parallelDataloader.NumThreads() = 4;
+
+  serialDataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, false);
+  parallelDataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, false);
+
+  REQUIRE(parallelDataloader.TestFeatures().n_cols == 1000);
+  REQUIRE(parallelDataloader.TestFeatures().n_rows == 32 * 32 * 3);
+
+  // Images and labels must be in the same columns for any number of threads.
+  REQUIRE(arma::approx_equal(serialDataloader.TestFeatures(),
+      parallelDataloader.TestFeatures(), "absdiff", 0.0));
+  REQUIRE(arma::approx_equal(serialDataloader.TestLabels(),
+      parallelDataloader.TestLabels(), "absdiff", 0.0));
+}
+
+/**
+ * Check that images stored as 8-bit pixels match images stored as doubles.
+ */
+TEST_CASE("Uint8ImageDatasetTest", "[DataLoadersTest]")
+{
+  // Download the test dataset.
+  Utils::DownloadFile("/datasets/cifar-test.tar.gz",
+    "./../data/cifar-test.tar.gz", "", false, true,
+    "www.mlpack.org", true);
+
+  DataLoader<> dataloader;
+  DataLoader<arma::Mat<uint8_t>> compactDataloader;
+  dataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, true, 0.2, false);
+  compactDataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, true, 0.2, false);
+
+  REQUIRE(compactDataloader.TrainFeatures().n_cols == 800);
+  REQUIRE(arma::approx_equal(dataloader.TrainFeatures(),
+      arma::conv_to<arma::mat>::from(compactDataloader.TrainFeatures()),
+      "absdiff", 0.0));
+  REQUIRE(arma::approx_equal(dataloader.TrainLabels(),
+      compactDataloader.TrainLabels(), "absdiff", 0.0));
+
+  // Batches are converted to the element type of the model.
+  arma::Mat<uint8_t> images;
+  arma::mat features, labels;
+  compactDataloader.TrainBatch(0, 16, images, labels);
+  PreProcessor<>::ConvertImages(images, features, 1.0 / 255);
+  REQUIRE(arma::approx_equal(features,
+      dataloader.TrainFeatures().cols(0, 15) / 255.0, "absdiff", 1e-12));
+
+  // The prefetcher converts batches as well.
+  BatchPrefetcher<> prefetcher(compactDataloader, 16, 2, false);
+  size_t begin = 0;
+  REQUIRE(prefetcher.Next(features, labels, begin));
+  REQUIRE(arma::approx_equal(features, dataloader.TrainFeatures().cols(0, 15),
+      "absdiff", 0.0));
+}
+
+/**
+ * Check that batches of a lazily loaded dataset match the eagerly loaded
+ * dataset.
+ */
+TEST_CASE("LazyImageDatasetTest", "[DataLoadersTest]")
+{
+  // Download the test dataset.
+  Utils::DownloadFile("/datasets/cifar-test.tar.gz",
+    "./../data/cifar-test.tar.gz", "", false, true,
+    "www.mlpack.org", true);
+
+  DataLoader<> eagerDataloader, lazyDataloader;
+  lazyDataloader.Lazy() = true;
+
+  eagerDataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, true, 0.2, false);
+  lazyDataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, true, 0.2, false);
+
+  // No image must be held in memory.
+  REQUIRE(lazyDataloader.TrainFeatures().n_elem == 0);
+  REQUIRE(lazyDataloader.TrainSize() == 800);
+  REQUIRE(lazyDataloader.ValidSize() == 200);
+
+  arma::mat features, labels;
+  lazyDataloader.TrainBatch(0, 32, features, labels);
+  REQUIRE(features.n_cols == 32);
+  REQUIRE(arma::approx_equal(features,
+      eagerDataloader.TrainFeatures().cols(0, 31), "absdiff", 0.0));
+  REQUIRE(arma::approx_equal(labels,
+      eagerDataloader.TrainLabels().cols(0, 31), "absdiff", 0.0));
+
+  lazyDataloader.ValidBatch(168, 32, features, labels);
+  REQUIRE(arma::approx_equal(features,
+      eagerDataloader.ValidFeatures().cols(168, 199), "absdiff", 0.0));
+}
+
+/**
+ * Check that a cached image dataset matches the decoded dataset.
+ */
+TEST_CASE("CachedImageDatasetTest", "[DataLoadersTest]")
+{
+  // Download the test dataset.
+  Utils::DownloadFile("/datasets/cifar-test.tar.gz",
+    "./../data/cifar-test.tar.gz", "", false, true,
+    "www.mlpack.org", true);
+
+  const std::string cachePath = "./../data/cifar-test-cache/";
+  boost::filesystem::remove_all(cachePath);
+
+  // The first load decodes images and writes the cache.
+  DataLoader<> decodedDataloader;
+  decodedDataloader.CachePath() = cachePath;
+  decodedDataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, false, 0.2, false, {"resize = (16, 16)"});
+
+  std::vector<boost::filesystem::path> cacheFiles;
+  Utils::ListDir(cachePath, cacheFiles);
+  REQUIRE(cacheFiles.size() == 1);
+
+  // The second load maps the cache.
+  DataLoader<> cachedDataloader;
+  cachedDataloader.CachePath() = cachePath;
+  cachedDataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, false, 0.2, false, {"resize = (16, 16)"});
+
+  REQUIRE(cachedDataloader.TestFeatures().n_rows == 16 * 16 * 3);
+  REQUIRE(cachedDataloader.TestFeatures().n_cols == 1000);
+  REQUIRE(arma::approx_equal(decodedDataloader.TestFeatures(),
+      cachedDataloader.TestFeatures(), "absdiff", 0.0));
+  REQUIRE(arma::approx_equal(decodedDataloader.TestLabels(),
+      cachedDataloader.TestLabels(), "absdiff", 0.0));
+
+  // A different shape must not use the same cache file.
+  DataLoader<> resizedDataloader;
+  resizedDataloader.CachePath() = cachePath;
+  resizedDataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, false, 0.2, false, {"resize = (8, 8)"});
+  REQUIRE(resizedDataloader.TestFeatures().n_rows == 8 * 8 * 3);
+
+  cacheFiles.clear();
+  Utils::ListDir(cachePath, cacheFiles);
+  REQUIRE(cacheFiles.size() == 2);
+
+  boost::filesystem::remove_all(cachePath);
+}
+
+/**
+ * Check that the prefetcher returns the batches of the training set in order
+ * and rethrows errors raised while preparing batches.
+ */
+TEST_CASE("BatchPrefetcherTest", "[DataLoadersTest]")
+{
+  Utils::DownloadFile("/datasets/iris.csv", "./../data/iris.csv");
+
+  DataLoader<> irisDataloader;
+  irisDataloader.LoadCSV("./../data/iris.csv", true, true, 0.5, false, 0, -1,
+      1, -1);
+
+  BatchPrefetcher<> prefetcher(irisDataloader, 16, 2, false);
+  REQUIRE(prefetcher.NumBatches() == 5);
+
+  // Check two epochs to make sure the producer continues after an epoch.
+  for (size_t epoch = 0; epoch < 2; epoch++)
+  {
+    REQUIRE(prefetcher.Epoch() == epoch);
+    arma::mat features, labels;
+    size_t begin = 0, batches = 0;
+    while (prefetcher.Next(features, labels, begin))
+    {
+      const size_t end = std::min(begin + 16, (size_t) 75) - 1;
+      REQUIRE(begin == batches * 16);
+      REQUIRE(arma::approx_equal(features,
+          irisDataloader.TrainFeatures().cols(begin, end), "absdiff", 0.0));
+      REQUIRE(arma::approx_equal(labels,
+          irisDataloader.TrainLabels().cols(begin, end), "absdiff", 0.0));
+      batches++;
+    }
+
+    REQUIRE(batches == 5);
+  }
+
+  // A Reset() at the end of an epoch doesn't skip an index, a Reset() in the
+  // middle of an epoch starts the next one.
+  REQUIRE(prefetcher.Epoch() == 2);
+  prefetcher.Reset();
+  REQUIRE(prefetcher.Epoch() == 2);
+  arma::mat batchFeatures, batchLabels;
+  REQUIRE(prefetcher.Next(batchFeatures, batchLabels));
+  prefetcher.Reset();
+  REQUIRE(prefetcher.Epoch() == 3);
+
+  // Errors raised by the producer must reach the consumer.
+  BatchPrefetcher<> failingPrefetcher([](const arma::uvec& /* indices */,
+      arma::mat& /* features */, arma::mat& /* labels */)
+      {
+        mlpack::Log::Fatal << "Unable to load batch." << std::endl;
+      }, 10, 5);
+
+  arma::mat features, labels;
+  REQUIRE_THROWS_AS(failingPrefetcher.Next(features, labels),
+      std::runtime_error);
+
+  Utils::RemoveFile("./../data/iris.csv");
+}
+
+/**
+ * Check that training batches are augmented reproducibly, and differently in
+ * every epoch.
+ */
+TEST_CASE("BatchAugmentationTest", "[DataLoadersTest]")
+{
+  // Download the test dataset.
+  Utils::DownloadFile("/datasets/cifar-test.tar.gz",
+    "./../data/cifar-test.tar.gz", "", false, true,
+    "www.mlpack.org", true);
+
+  DataLoader<> dataloader, batchDataloader;
+  batchDataloader.AugmentBatches() = true;
+  batchDataloader.AugmentationSeed() = 7;
+
+  const std::vector<std::string> augmentations = {"horizontal-flip",
+      "random-crop (4)"};
+  dataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, true, 0.2, false);
+  batchDataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, true, 0.2, false, augmentations, 0.5);
+
+  // The training set isn't augmented when it's loaded.
+  REQUIRE(!batchDataloader.BatchAugmentation().Empty());
+  REQUIRE(arma::approx_equal(batchDataloader.TrainFeatures(),
+      dataloader.TrainFeatures(), "absdiff", 0.0));
+
+  // The same epoch gives the same batch, regardless of the other data points
+  // of the batch.
+  arma::mat features, labels, repeated, single;
+  batchDataloader.TrainBatch(0, 32, features, labels, 0);
+  batchDataloader.TrainBatch(0, 32, repeated, labels, 0);
+  batchDataloader.TrainBatch(5, 1, single, labels, 0);
+  REQUIRE(arma::approx_equal(features, repeated, "absdiff", 0.0));
+  REQUIRE(arma::approx_equal(features.col(5), single, "absdiff", 0.0));
+  REQUIRE(arma::accu(features != dataloader.TrainFeatures().cols(0, 31)) > 0);
+
+  // Another epoch gives other augmentations.
+  batchDataloader.TrainBatch(0, 32, repeated, labels, 1);
+  REQUIRE(arma::accu(features != repeated) > 0);
+
+  // Validation batches aren't augmented.
+  batchDataloader.ValidBatch(0, 32, features, labels);
+  REQUIRE(arma::approx_equal(features, dataloader.ValidFeatures().cols(0, 31),
+      "absdiff", 0.0));
+}
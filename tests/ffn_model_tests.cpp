@@ -12,6 +12,7 @@
 #include <utils/utils.hpp>
 #include <ensmallen.hpp>
 #include <dataloader/dataloader.hpp>
+#include <ensmallen_utils/prefetched_function.hpp>
 #include <models/darknet/darknet.hpp>
 #include <models/yolo/yolo.hpp>
 #include <models/resnet/resnet.hpp>
@@ -102,6 +103,72 @@ TEST_CASE("YOLOV1ModelTest", "[FFNModelsTests]")
   ModelDimTest(yolo.GetModel(), input, (7 * 7 * (5 * 2 + 20)), 1);
 }
 
+/**
+ * Test changing the input resolution of YOLOv1 for multi-scale training.
+ */
+TEST_CASE("YOLOV1MultiScaleTest", "[FFNModelsTests]")
+{
+  YOLO<> yolo(3, 320, 288);
+  const arma::mat parameters = yolo.GetModel().Parameters();
+
+  // The model keeps its weights and the shape of its output.
+  yolo.SetInputResolution(448, 448);
+  REQUIRE(yolo.InputWidth() == 448);
+  REQUIRE(yolo.InputHeight() == 448);
+  REQUIRE(arma::approx_equal(yolo.GetModel().Parameters(), parameters,
+      "absdiff", 1e-12));
+
+  arma::mat input(448 * 448 * 3, 2, arma::fill::randu);
+  ModelDimTest(yolo.GetModel(), input, (7 * 7 * (5 * 2 + 20)), 2);
+
+  yolo.SetInputResolution(320, 288);
+  input.randu(320 * 288 * 3, 1);
+  ModelDimTest(yolo.GetModel(), input, (7 * 7 * (5 * 2 + 20)), 1);
+
+  // The feature map can't be smaller than the output of the last pooling
+  // layer, which is 10 x 9 for 320 x 288 images.
+  REQUIRE_THROWS_AS(yolo.SetInputResolution(288, 288), std::runtime_error);
+  yolo.SetInputResolution(289, 257);
+  REQUIRE(yolo.InputWidth() == 289);
+}
+
+/**
+ * Test that PrefetchedFunction computes gradients in training mode, even
+ * after the network was evaluated in testing mode.
+ */
+TEST_CASE("PrefetchedFunctionTrainingModeTest", "[FFNModelsTests]")
+{
+  // Batches of 8 random data points with 4 features.
+  BatchPrefetcher<> prefetcher([](const arma::uvec& indices,
+      arma::mat& features, arma::mat& labels)
+      {
+        features.randu(4, indices.n_elem);
+        labels.randu(1, indices.n_elem);
+      }, 32, 8, 2, false);
+
+  typedef mlpack::ann::FFN<mlpack::ann::MeanSquaredError<>> NetworkType;
+  NetworkType model;
+  model.Add<mlpack::ann::Linear<>>(4, 1);
+  mlpack::ann::Dropout<>* dropout = new mlpack::ann::Dropout<>(0.5);
+  model.Add(dropout);
+
+  ens::PrefetchedFunction<NetworkType> function(model, prefetcher);
+  arma::mat gradient;
+  function.EvaluateWithGradient(model.Parameters(), 0, gradient, 8);
+  REQUIRE(!dropout->Deterministic());
+
+  // Evaluate() uses testing mode, and restores training mode.
+  function.Evaluate(model.Parameters(), 8, 8);
+  REQUIRE(!dropout->Deterministic());
+
+  // Predict() leaves the network in testing mode.
+  arma::mat input(4, 2, arma::fill::randu), output;
+  model.Predict(input, output);
+  REQUIRE(dropout->Deterministic());
+  function.EvaluateWithGradient(model.Parameters(), 16, gradient, 8);
+  REQUIRE(!dropout->Deterministic());
+}
+
 /**
  * Simple test for ResNet(18, 34, 50) models.
  */
@@ -11,6 +11,7 @@
  */
 #include <dataloader/preprocessor.hpp>
 #include <dataloader/dataloader.hpp>
+#include <models/yolo/yolo_decoder.hpp>
 #include "catch.hpp"
 
 using namespace mlpack::models;
@@ -95,3 +96,296 @@ TEST_CASE("YOLOPreProcessor", "[PreProcessorsTest]")
       REQUIRE(desiredOutput(i) == Approx(output(i)).epsilon(1e-2));
   }
 }
+
+/**
+ * Check that YOLOPreProcessor drops boxes beyond the number of boxes of a cell,
+ * skips padding boxes and rejects classes that are out of range.
+ */
+TEST_CASE("YOLOPreProcessorFullCellTest", "[PreProcessorsTest]")
+{
+  // Three boxes in the same cell, followed by a padding box.
+  arma::field<arma::vec> input(1, 2);
+  input(0, 0) = arma::vec({1, 0, 0, 10, 10, 1, 0, 0, 10, 10, 1, 0, 0, 10, 10,
+      -1, 0, 0, 0, 0});
+  input(0, 1) = arma::vec({1, 0, 0, 10, 10});
+
+  arma::mat output;
+  PreProcessor<arma::mat, arma::field<arma::vec>>::YOLOPreProcessor(
+      input, output, 3, 500, 387, 13, 13, 2, 80);
+
+  REQUIRE(output.n_rows == 13 * 13 * 2 * 85);
+  REQUIRE(output.n_cols == 2);
+
+  // Only two boxes of the first image are encoded.
+  REQUIRE(arma::accu(output.col(0)) ==
+      Approx(2 * arma::accu(output.col(1))).epsilon(1e-7));
+  REQUIRE(arma::accu(output.col(0) == 1.0) == 4);
+
+  // Classes must be less than the number of classes.
+  input(0, 1) = arma::vec({80, 0, 0, 10, 10});
+  REQUIRE_THROWS_AS((PreProcessor<arma::mat, arma::field<arma::vec>>::
+      YOLOPreProcessor(input, output, 3, 500, 387, 13, 13, 2, 80)),
+      std::runtime_error);
+  REQUIRE_THROWS_AS((PreProcessor<arma::mat, arma::field<arma::vec>>::
+      YOLOPreProcessor(input, output, 1, 500, 387, 13, 13, 2, 80)),
+      std::runtime_error);
+}
+
+/**
+ * Check that YOLOPreProcessor stores cells of a grid that isn't square one row
+ * of the grid after another, without boxes of different cells overlapping.
+ */
+TEST_CASE("YOLOPreProcessorNonSquareGridTest", "[PreProcessorsTest]")
+{
+  // A 4 x 2 grid with 8 cells per prediction. The first box is in cell
+  // (3, 1) and the second box is in cell (1, 1).
+  arma::field<arma::vec> input(1, 1);
+  input(0, 0) = arma::vec({1, 300, 100, 400, 200, 0, 100, 100, 200, 200});
+
+  arma::vec expected(8 * 7, arma::fill::zeros);
+  const size_t cells[2] = {7, 5}, labels[2] = {1, 0};
+  for (size_t i = 0; i < 2; i++)
+  {
+    expected(cells[i]) = 0.5;
+    expected(cells[i] + 8) = 0.5;
+    expected(cells[i] + 16) = 0.25;
+    expected(cells[i] + 24) = 0.5;
+    expected(cells[i] + 32) = 1;
+    expected(cells[i] + (5 + labels[i]) * 8) = 1;
+  }
+
+  // With one box per cell, YOLOv1 and YOLOv3 targets have the same layout.
+  for (size_t version = 1; version <= 3; version += 2)
+  {
+    arma::mat output;
+    PreProcessor<arma::mat, arma::field<arma::vec>>::YOLOPreProcessor(
+        input, output, version, 400, 200, 4, 2, 1, 2);
+
+    REQUIRE(output.n_rows == expected.n_elem);
+    REQUIRE(arma::approx_equal(output.col(0), expected, "absdiff", 1e-7));
+  }
+}
+
+/**
+ * Check that YOLOPreProcessor assigns boxes to the anchor with the highest IoU,
+ * encodes them relative to the anchor at its scale and rejects classes that
+ * are out of range.
+ */
+TEST_CASE("YOLOPreProcessorAnchorTest", "[PreProcessorsTest]")
+{
+  // Two anchors per scale, a 4 x 2 grid and an 8 x 4 grid.
+  const arma::mat anchors({{100, 200, 10, 20}, {100, 50, 10, 40}});
+  const arma::umat grids({{4, 8}, {2, 4}});
+
+  // A 180 x 60 box matching the second anchor, a 16 x 36 box matching the
+  // fourth anchor and a padding box.
+  arma::field<arma::vec> input(1, 2);
+  input(0, 0) = arma::vec({1, 10, 20, 190, 80, 0, 12, 4, 28, 40,
+      -1, 0, 0, 0, 0});
+  input(0, 1) = arma::vec();
+
+  arma::mat output;
+  PreProcessor<arma::mat, arma::field<arma::vec>>::YOLOPreProcessor(
+      input, output, anchors, grids, 400, 200, 3);
+
+  REQUIRE(output.n_rows == (4 * 2 + 8 * 4) * 2 * 8);
+  REQUIRE(arma::accu(output.col(1)) == 0.0);
+
+  const arma::mat iou = PreProcessor<>::AnchorIoU(arma::mat({{180, 16},
+      {60, 36}}), anchors);
+  REQUIRE(iou(0, 1) == Approx(9000.0 / 11800.0).epsilon(1e-7));
+  REQUIRE(iou(1, 3) == Approx(576.0 / 800.0).epsilon(1e-7));
+
+  // The first box is in cell (1, 0) of the first scale, with 8 cells per
+  // prediction.
+  arma::vec expected(output.n_rows, arma::fill::zeros);
+  size_t cell = 64 + 1;
+  expected(cell + 8) = 0.5;
+  expected(cell + 16) = std::log(180.0 / 200);
+  expected(cell + 24) = std::log(60.0 / 50);
+  expected(cell + 32) = 1;
+  expected(cell + 48) = 1;
+
+  // The second box is in cell (0, 0) of the second scale, with 32 cells per
+  // prediction.
+  cell = 128 + 256;
+  expected(cell) = 0.4;
+  expected(cell + 32) = 0.44;
+  expected(cell + 64) = std::log(16.0 / 20);
+  expected(cell + 96) = std::log(36.0 / 40);
+  expected(cell + 128) = 1;
+  expected(cell + 160) = 1;
+
+  REQUIRE(arma::approx_equal(output.col(0), expected, "absdiff", 1e-7));
+
+  // Classes must be less than the number of classes.
+  input(0, 1) = arma::vec({3, 10, 20, 190, 80});
+  REQUIRE_THROWS_AS((PreProcessor<arma::mat, arma::field<arma::vec>>::
+      YOLOPreProcessor(input, output, anchors, grids, 400, 200, 3)),
+      std::runtime_error);
+}
+
+/**
+ * Check that YOLODecoder inverts YOLOPreProcessor and suppresses overlapping
+ * detections of the same class.
+ */
+TEST_CASE("YOLODecoderTest", "[PreProcessorsTest]")
+{
+  const arma::mat anchors({{100, 200, 10, 20}, {100, 50, 10, 40}});
+  const arma::umat grids({{4, 8}, {2, 4}});
+
+  arma::field<arma::vec> input(1, 2);
+  input(0, 0) = arma::vec({1, 10, 20, 190, 80, 0, 12, 4, 28, 40});
+  input(0, 1) = arma::vec({2, 300, 100, 340, 150});
+
+  arma::mat targets;
+  PreProcessor<arma::mat, arma::field<arma::vec>>::YOLOPreProcessor(
+      input, targets, anchors, grids, 400, 200, 3);
+
+  // Detections are sorted by class, and have a score of 1.
+  arma::field<arma::vec> detections;
+  YOLODecoder decoder(anchors, grids, 400, 200, 3, 0.5, 0.45);
+  decoder.Decode(targets, detections);
+  REQUIRE(detections.n_cols == 2);
+  REQUIRE(arma::approx_equal(detections(0, 0), arma::vec({0, 12, 4, 28, 40, 1,
+      1, 10, 20, 190, 80, 1}), "absdiff", 1e-7));
+  REQUIRE(arma::approx_equal(detections(0, 1), arma::vec({2, 300, 100, 340,
+      150, 1}), "absdiff", 1e-7));
+
+  // Two YOLOv1 boxes of the same cell that overlap, with a score above the
+  // threshold for two classes.
+  arma::mat predictions(7 * 7 * 13, 1, arma::fill::zeros);
+  const size_t cells = 49, cell = 3 + 7 * 2;
+  const double boxes[10] = {0.5, 0.5, 0.2, 0.1, 0.9, 0.5, 0.5, 0.21, 0.1, 0.8};
+  for (size_t i = 0; i < 10; i++)
+    predictions(cell + i * cells) = boxes[i];
+  predictions(cell + 11 * cells) = 1.0;
+  predictions(cell + 12 * cells) = 0.3;
+
+  YOLODecoder gridDecoder(448, 448, 7, 7, 2, 3, 0.2, 0.5);
+  gridDecoder.Decode(predictions, detections);
+  REQUIRE(arma::approx_equal(detections(0, 0), arma::vec({1, 179.2, 137.6,
+      268.8, 182.4, 0.9, 2, 179.2, 137.6, 268.8, 182.4, 0.27}), "absdiff",
+      1e-7));
+
+  // YOLOv1 targets of a 4 x 2 grid decode to the encoded boxes.
+  input.set_size(1, 1);
+  input(0, 0) = arma::vec({1, 300, 100, 400, 200, 2, 100, 100, 200, 200});
+  PreProcessor<arma::mat, arma::field<arma::vec>>::YOLOPreProcessor(
+      input, targets, 1, 400, 200, 4, 2, 1, 3);
+
+  YOLODecoder nonSquareDecoder(400, 200, 4, 2, 1, 3, 0.5, 0.45);
+  nonSquareDecoder.Decode(targets, detections);
+  REQUIRE(detections.n_cols == 1);
+  REQUIRE(arma::approx_equal(detections(0, 0), arma::vec({1, 300, 100, 400,
+      200, 1, 2, 100, 100, 200, 200, 1}), "absdiff", 1e-7));
+}
+
+/**
+ * Check that anchors generated with k-means match clusters of box sizes.
+ */
+TEST_CASE("YOLOAnchorsTest", "[PreProcessorsTest]")
+{
+  // Boxes around three sizes, followed by a padding box.
+  const double sizes[3][2] = {{10, 10}, {50, 20}, {100, 200}};
+  arma::field<arma::vec> input(1, 3000);
+  for (size_t i = 0; i < input.n_cols; i++)
+  {
+    const double width = sizes[i % 3][0] * (0.95 + 0.1 * arma::randu());
+    const double height = sizes[i % 3][1] * (0.95 + 0.1 * arma::randu());
+    input(0, i) = arma::vec({(double) (i % 3), 5, 5, 5 + width, 5 + height,
+        -1, 0, 0, 0, 0});
+  }
+
+  arma::mat anchors;
+  const double iou = PreProcessor<arma::mat, arma::field<arma::vec>>::
+      YOLOAnchors(input, anchors, 3, 3, 100, 7);
+
+  REQUIRE(iou > 0.9);
+  REQUIRE(anchors.n_rows == 2);
+  REQUIRE(anchors.n_cols == 3);
+  for (size_t k = 0; k < 3; k++)
+  {
+    REQUIRE(anchors(0, k) == Approx(sizes[k][0]).epsilon(0.02));
+    REQUIRE(anchors(1, k) == Approx(sizes[k][1]).epsilon(0.02));
+  }
+
+  // The same seed gives the same anchors.
+  arma::mat sameAnchors;
+  PreProcessor<arma::mat, arma::field<arma::vec>>::YOLOAnchors(input,
+      sameAnchors, 3, 3, 100, 7);
+  REQUIRE(arma::approx_equal(anchors, sameAnchors, "absdiff", 0.0));
+}
+
+/**
+ * Check that 8-bit images are converted, scaled and centered per channel.
+ */
+TEST_CASE("ConvertImagesTest", "[PreProcessorsTest]")
+{
+  // Two images with two pixels of three channels each.
+  arma::Mat<uint8_t> images(6, 2);
+  for (size_t i = 0; i < images.n_elem; i++)
+    images(i) = 20 * i;
+
+  arma::mat output;
+  PreProcessor<>::ConvertImages(images, output);
+  REQUIRE(arma::approx_equal(output, arma::conv_to<arma::mat>::from(images),
+      "absdiff", 0.0));
+
+  const arma::vec mean({0.1, 0.2, 0.3});
+  PreProcessor<>::ConvertImages(images, output, 1.0 / 255, mean);
+  for (size_t i = 0; i < images.n_elem; i++)
+  {
+    REQUIRE(output(i) == Approx(images(i) / 255.0 - mean(i % 3)).
+        epsilon(1e-7));
+  }
+
+  // A single mean is subtracted from every channel.
+  arma::fmat floatOutput;
+  PreProcessor<>::ConvertImages(images, floatOutput, 2.0, arma::vec({1.0}));
+  REQUIRE(floatOutput(5, 1) == Approx(2.0 * images(5, 1) - 1.0));
+}
+
+/**
+ * Check that images of any shape are converted to the channel first format
+ * and normalized.
+ */
+TEST_CASE("ChannelFirstImagesTest", "[PreProcessorsTest]")
+{
+  // Two images of 5 x 3 pixels with 2 channels.
+  const size_t width = 5, height = 3, depth = 2;
+  arma::mat images(width * height * depth, 2);
+  for (size_t i = 0; i < images.n_elem; i++)
+    images(i) = i % 256;
+
+  arma::mat converted = images;
+  PreProcessor<>::ChannelFirstImages(converted, width, height, depth, false);
+  for (size_t col = 0; col < images.n_cols; col++)
+  {
+    for (size_t y = 0; y < height; y++)
+    {
+      for (size_t x = 0; x < width; x++)
+      {
+        for (size_t c = 0; c < depth; c++)
+        {
+          REQUIRE(converted((c * height + y) * width + x, col) ==
+              images((y * width + x) * depth + c, col));
+        }
+      }
+    }
+  }
+
+  // Images larger than a block of pixels are normalized in the same pass.
+  arma::mat large = arma::randi<arma::mat>(300 * 2 * 3, 3,
+      arma::distr_param(0, 255));
+  arma::mat normalized = large;
+  PreProcessor<>::ChannelFirstImages(normalized, 300, 2, 3);
+  for (size_t p = 0; p < 600; p++)
+  {
+    for (size_t c = 0; c < 3; c++)
+    {
+      REQUIRE(normalized(c * 600 + p, 2) ==
+          Approx(large(p * 3 + c, 2) / 255.0).epsilon(1e-12));
+    }
+  }
+}
@@ -0,0 +1,149 @@
+/**
+ * @file mapped_file.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of MappedFile class for read-only memory-mapped files.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+
+#ifndef MODELS_UTILS_MAPPED_FILE_HPP
+#define MODELS_UTILS_MAPPED_FILE_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+#ifndef _WIN32
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+#endif
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Maps a file into memory. Pages are private to the process, so the mapped
+ * memory may be written to without modifying the file. On platforms without
+ * mmap the file is read into memory instead.
+ *
+ * @code
+ * MappedFile file;
+ * if (file.Open("path/to/file"))
+ *   std::cout << file.Size() << " bytes mapped." << std::endl;
+ * @endcode
+ */
+class MappedFile
+{
+ public:
+  //! Create an empty MappedFile object.
+  MappedFile() : data(nullptr), size(0)
+  {
+    // Nothing to do here.
+  }
+
+  //! Unmaps the file.
+  ~MappedFile()
+  {
+    Close();
+  }
+
+  // The mapping can't be shared between objects.
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /**
+   * Maps the given file, unmapping the previously mapped file.
+   *
+   * @param path Path to the file.
+   * @return true if the file was mapped else false.
+   */
+  bool Open(const std::string& path)
+  {
+    Close();
+
+    #ifndef _WIN32
+    const int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+      return false;
+
+    struct stat info;
+    if (fstat(file, &info) != 0 || info.st_size <= 0)
+    {
+      close(file);
+      return false;
+    }
+
+    void* mapped = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE, file, 0);
+
+    // The mapping stays valid after the file is closed.
+    close(file);
+    if (mapped == MAP_FAILED)
+      return false;
+
+    data = static_cast<char*>(mapped);
+    size = info.st_size;
+    #else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open() || file.tellg() <= 0)
+      return false;
+
+    buffer.resize(file.tellg());
+    file.seekg(0);
+    if (!file.read(buffer.data(), buffer.size()))
+    {
+      buffer.clear();
+      return false;
+    }
+
+    data = buffer.data();
+    size = buffer.size();
+    #endif
+
+    return true;
+  }
+
+  //! Unmaps the file.
+  void Close()
+  {
+    #ifndef _WIN32
+    if (data != nullptr)
+      munmap(data, size);
+    #else
+    buffer.clear();
+    buffer.shrink_to_fit();
+    #endif
+
+    data = nullptr;
+    size = 0;
+  }
+
+  //! Get the mapped memory.
+  char* Data() const { return data; }
+
+  //! Get the size of the mapped file in bytes.
+  size_t Size() const { return size; }
+
+ private:
+  //! Locally stored pointer to the mapped memory.
+  char* data;
+
+  //! Locally stored size of the mapped file.
+  size_t size;
+
+  #ifdef _WIN32
+  //! Locally stored contents of the file when mmap isn't available.
+  std::vector<char> buffer;
+  #endif
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
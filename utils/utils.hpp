@@ -21,6 +21,10 @@
 #include <mlpack/core.hpp>
 #include <boost/filesystem.hpp>
 
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
 namespace mlpack {
 namespace models {
 
@@ -310,6 +314,23 @@ class Utils
     return 0;
   }
 
+  /**
+   * Get the number of threads that a parallel region should use.
+   *
+   * @param numThreads Requested number of threads. If 0, all threads
+   *     available to OpenMP are used.
+   * @returns Number of threads to be used, 1 if OpenMP isn't available.
+   */
+  static int NumThreads(const size_t numThreads = 0)
+  {
+    #ifdef _OPENMP
+      return numThreads > 0 ? (int) numThreads : omp_get_max_threads();
+    #else
+      (void) numThreads;
+      return 1;
+    #endif
+  }
+
   /**
    * Fills a vector with paths to all files in directory.
    *